@@ -18,6 +18,9 @@
 //if there's a huge number of links, please reduce messge buffer via ASCS_MAX_SEND_BUF and ASCS_MAX_RECV_BUF macro.
 //please think about if we have 512 links, how much memory we can accupy at most with default ASCS_MAX_SEND_BUF and ASCS_MAX_RECV_BUF?
 //it's 2 * 1M * 512 = 1G
+//or bound the total size of all send buffers and all recv buffers via ASCS_SEND_BUF_BUDGET and ASCS_RECV_BUF_BUDGET macro.
+//#define ASCS_SEND_BUF_BUDGET	268435456 //256M
+//#define ASCS_RECV_BUF_BUDGET	268435456 //256M
 
 //use the following macro to control the type of packer and unpacker
 #define PACKER_UNPACKER_TYPE	0
@@ -273,6 +276,12 @@ int main(int argc, const char* argv[])
 			statistic this_stat = echo_server_.get_statistic();
 			puts((this_stat - last_stat).to_string().data());
 			last_stat = this_stat;
+#ifdef ASCS_SEND_BUF_BUDGET
+			printf("send buffer budget: " ASCS_SF " / " ASCS_SF "\n", send_buffer_budget().usage(), send_buffer_budget().capacity());
+#endif
+#ifdef ASCS_RECV_BUF_BUDGET
+			printf("recv buffer budget: " ASCS_SF " / " ASCS_SF "\n", recv_buffer_budget().usage(), recv_buffer_budget().capacity());
+#endif
 		}
 		else if (STATUS == str)
 		{
@@ -299,7 +308,7 @@ int main(int argc, const char* argv[])
 			//so need \0 character when printing it.
 //			*/
 			/*
-			//if all clients used the same protocol, we can pack msg one time, and send it repeatedly like this:
+			//if all clients used the same protocol, we can pack msg one time, and send it repeatedly like this (or just call broadcast_shared_msg):
 			packer p;
 			auto msg = p.pack_msg(str.data(), str.size() + 1);
 			//send \0 character too, because demo client used basic_buffer as its msg type, it will not append \0 character automatically as std::string does,
@@ -308,6 +317,11 @@ int main(int argc, const char* argv[])
 				normal_server_.do_something_to_all([&msg](server_base<normal_socket>::object_ctype& item) {item->direct_send_msg(msg);});
 			*/
 			/*
+			//broadcast_shared_msg packs the msg only once too, if normal_socket used packer2<shared_buffer<i_buffer>> (the same protocol as packer),
+			//all clients would share one payload, with packer, only packing is saved (every client still gets its own copy).
+			normal_server_.broadcast_shared_msg(str.data(), str.size() + 1, false);
+			*/
+			/*
 			//if demo client is using stream_unpacker
 			normal_server_.do_something_to_all([&str](server_base<normal_socket>::object_ctype& item) {item->direct_send_msg(str);});
 			*/
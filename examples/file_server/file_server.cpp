@@ -6,6 +6,7 @@
 #define ASCS_RESTORE_OBJECT
 #define ASCS_ENHANCED_STABILITY
 #define ASCS_WANT_MSG_SEND_NOTIFY
+#define ASCS_FILE_REGION //transmit file content via sendfile(2) if possible, see ascs::file_region
 #define ASCS_INPUT_QUEUE non_lock_queue
 //file_server / file_client is a responsive system, before file_server send each message (except talking message,
 //but file_server only receive talking message, not send talking message proactively), the previous message has been
@@ -4,6 +4,7 @@
 #define ASCS_RESTORE_OBJECT
 #define ASCS_ENHANCED_STABILITY
 #define ASCS_WANT_MSG_SEND_NOTIFY
+#define ASCS_FILE_REGION //transmit file content via sendfile(2) if possible, see ascs::file_region
 #define ASCS_INPUT_QUEUE non_lock_queue
 //file_server / file_client is a responsive system, before file_server send each message (except talking message,
 //but file_server only receive talking message, not send talking message proactively), the previous message has been
@@ -37,6 +38,13 @@ bool file_socket::on_msg_handle(out_msg_type& msg) {handle_msg(msg); return true
 #ifdef ASCS_WANT_MSG_SEND_NOTIFY
 void file_socket::on_msg_send(in_msg_type& msg)
 {
+#ifdef ASCS_FILE_REGION
+	if (nullptr != ascs::to_file_region(msg)) //file region will be sent as a whole
+	{
+		trans_end();
+		return;
+	}
+#endif
 	auto buffer = dynamic_cast<file_buffer*>(&*msg.raw_buffer());
 	if (nullptr != buffer)
 	{
@@ -104,8 +112,12 @@ void file_socket::handle_msg(out_msg_ctype& msg)
 			if (offset >= 0 && length > 0 && offset + length <= ftello(file))
 			{
 				state = TRANS_BUSY;
+#ifdef ASCS_FILE_REGION
+				direct_send_msg(in_msg_type(new file_region(fileno(file), offset, (size_t) length)), true);
+#else
 				fseeko(file, offset, SEEK_SET);
 				direct_send_msg(in_msg_type(new file_buffer(file, length)), true);
+#endif
 			}
 		}
 		break;
@@ -7,6 +7,7 @@
 #define ASCS_DELAY_CLOSE	5 //define this to avoid hooks for async call (and slightly improve efficiency)
 #define ASCS_SYNC_DISPATCH
 //#define ASCS_WANT_MSG_SEND_NOTIFY
+//#define ASCS_WANT_BATCH_MSG_SEND_NOTIFY //keep multiple messages per write, on_msg_send will still be invoked for each of them
 #define ASCS_MSG_BUFFER_SIZE 65536
 #define ASCS_INPUT_QUEUE non_lock_queue //we will never operate sending buffer concurrently, so need no locks
 #define ASCS_DEFAULT_UNPACKER stream_unpacker //non-protocol
@@ -0,0 +1,188 @@
+
+#include <iostream>
+
+//configuration
+//configuration
+
+#include <ascs/ext/ext.h>
+#include <ascs/container.h>
+using namespace ascs;
+using namespace ascs::ext;
+
+//the same as the send buffer of ascs::socket (without ASCS_SYNC_SEND)
+typedef obj_with_begin_time<std::string> msg_type;
+typedef list<msg_type> container_type;
+typedef recycling_list<msg_type> recycling_container_type;
+
+//count memory allocations (of all threads), to tell how many of them recycling_list saves.
+static std::atomic_size_t alloc_num(0);
+void* operator new(size_t size)
+{
+	++alloc_num;
+	auto p = malloc(size > 0 ? size : 1);
+	if (nullptr == p)
+		throw std::bad_alloc();
+
+	return p;
+}
+void operator delete(void* p) noexcept {free(p);}
+
+static void print_result(const char* name, const char* container_name, size_t thread_num, double used_time, size_t total_num, size_t alloc_num_)
+{
+	printf("%-15s %-15s " ASCS_SF " producer(s): %f seconds, %.0f msgs/s, %.2f allocations/msg\n",
+		name, container_name, thread_num, used_time, total_num / used_time, (double) alloc_num_ / total_num);
+}
+
+//producers push messages concurrently, the consumer fetches them like tcp::socket_base::do_send_msg does.
+template<template<typename> class Queue, typename Container>
+void test(const char* name, const char* container_name, size_t thread_num, size_t msg_num, size_t msg_len)
+{
+	Queue<Container> queue;
+	std::vector<std::thread> producers;
+	auto alloc_num_begin = alloc_num.load();
+	cpu_timer begin_time;
+
+	for (size_t i = 0; i < thread_num; ++i)
+		producers.emplace_back([&]() {for (size_t j = 0; j < msg_num; ++j) queue.enqueue(std::string(msg_len, '0'));});
+
+	auto total_size = thread_num * msg_num * msg_len, size = (size_t) 0;
+	Container can;
+	while (size < total_size)
+	{
+		queue.move_items_out(asio::detail::default_max_transfer_size, can);
+		if (can.empty())
+			std::this_thread::yield();
+		else
+		{
+			size += ascs::get_size_in_byte(can);
+			can.clear();
+		}
+	}
+
+	for (auto& item : producers)
+		item.join();
+
+	auto used_time = begin_time.elapsed();
+	print_result(name, container_name, thread_num, used_time, thread_num * msg_num, alloc_num - alloc_num_begin);
+}
+
+//non_lock_queue is not thread safe, so producing and consuming must be done in one thread, just as a baseline.
+template<typename Container>
+void test_non_lock_queue(const char* container_name, size_t thread_num, size_t msg_num, size_t msg_len)
+{
+	non_lock_queue<Container> queue;
+	Container can;
+	auto alloc_num_begin = alloc_num.load();
+	cpu_timer begin_time;
+
+	auto total_num = thread_num * msg_num;
+	for (size_t i = 0; i < total_num; ++i)
+	{
+		queue.enqueue(std::string(msg_len, '0'));
+		if (queue.size_in_byte() >= asio::detail::default_max_transfer_size)
+		{
+			queue.move_items_out(asio::detail::default_max_transfer_size, can);
+			can.clear();
+		}
+	}
+	queue.move_items_out(can);
+
+	auto used_time = begin_time.elapsed();
+	print_result("non_lock_queue", container_name, 1, used_time, total_num, alloc_num - alloc_num_begin);
+}
+
+//feed zerocopy_list (the bookkeeping of tcp::socket_base for MSG_ZEROCOPY) with fake completion notifications, include out of order ones.
+static bool check(bool ok, const char* what) {if (!ok) printf("zerocopy_list: %s failed.\n", what); return ok;}
+static std::string complete(zerocopy_list<container_type>& msgs, uint32_t first_id, uint32_t last_id)
+{
+	std::string released;
+	msgs.complete(first_id, last_id, [&released](container_type& can) {for (auto& item : can) released += item;});
+	return released;
+}
+
+static std::string release(zerocopy_list<container_type>& msgs)
+{
+	std::string released;
+	msgs.release([&released](container_type& can) {for (auto& item : can) released += item;});
+	return released;
+}
+
+static void pin(zerocopy_list<container_type>& msgs, const char* name, uint32_t first_id, uint32_t last_id)
+{
+	container_type can;
+	can.emplace_back(std::string(name));
+	msgs.pin(can, std::begin(can), first_id, last_id);
+}
+
+bool test_zerocopy_list()
+{
+	auto re = true;
+	zerocopy_list<container_type> msgs;
+	pin(msgs, "A", 0, 0);
+	pin(msgs, "B", 1, 3); //sent via three zero copy sends
+	pin(msgs, "C", 4, 4);
+	re &= check(complete(msgs, 4, 4) == "C", "completing the last msg first");
+	re &= check(complete(msgs, 2, 2).empty(), "completing the middle of a msg");
+	re &= check(complete(msgs, 0, 1) == "A", "completing a range across two msgs");
+	re &= check(complete(msgs, 3, 3) == "B" && msgs.empty(), "completing the last id of a msg");
+
+	//ids wrap around
+	pin(msgs, "D", 0xfffffffe, 0xffffffff);
+	pin(msgs, "E", 0, 1);
+	re &= check(complete(msgs, 0xffffffff, 0).empty(), "completing ids across the wrap around point");
+	re &= check(complete(msgs, 1, 1) == "E", "completing the last id after the wrap around point");
+	re &= check(complete(msgs, 0xfffffffe, 0xfffffffe) == "D" && msgs.empty(), "completing the first id before the wrap around point");
+
+	//the kernel can release msgs before they been pinned (they're pinned after the whole batch been sent)
+	re &= check(complete(msgs, 2, 4).empty(), "completing ids of msgs which have not been pinned");
+	pin(msgs, "G", 2, 3);
+	pin(msgs, "H", 4, 5);
+	re &= check(release(msgs) == "G" && 1 == msgs.size(), "releasing a msg which completed before been pinned");
+	re &= check(complete(msgs, 5, 6) == "H", "completing a msg and ids of a msg which has not been pinned");
+	pin(msgs, "I", 6, 6);
+	re &= check(release(msgs) == "I" && msgs.empty(), "releasing the rest of early completed ids");
+
+	//one range covers many msgs
+	for (uint32_t i = 0; i < 10; ++i)
+		pin(msgs, "F", i, i);
+	re &= check(complete(msgs, 5, 9) == "FFFFF" && 5 == msgs.size(), "completing the second half first");
+	re &= check(complete(msgs, 0, 4) == "FFFFF" && msgs.empty(), "completing the first half");
+
+	if (re)
+		puts("zerocopy_list: all tests passed.");
+	return re;
+}
+
+int main(int argc, const char* argv[])
+{
+	printf("usage: %s [<producer number=4> [<message number of each producer=1000000> [<message length=64>]]]\n", argv[0]);
+	if (argc >= 2 && (0 == strcmp(argv[1], "--help") || 0 == strcmp(argv[1], "-h")))
+		return 0;
+
+	size_t thread_num = 4, msg_num = 1000000, msg_len = 64;
+	if (argc > 1)
+		thread_num = std::max(atoi(argv[1]), 1);
+	if (argc > 2)
+		msg_num = std::max(atoi(argv[2]), 1);
+	if (argc > 3)
+		msg_len = std::max(atoi(argv[3]), 1); //zero length messages cannot be counted
+
+	if (!test_zerocopy_list())
+		return 1;
+
+	//recycling_list saves list node allocations only if nodes are freed in the thread which will allocate them again,
+	//so with lock_queue and multiple producers (nodes are allocated in producers but freed in the consumer), nothing will be saved.
+	test_non_lock_queue<container_type>("list", thread_num, msg_num, msg_len);
+	test_non_lock_queue<recycling_container_type>("recycling_list", thread_num, msg_num, msg_len);
+	test<lock_queue, container_type>("lock_queue", "list", thread_num, msg_num, msg_len);
+	test<lock_queue, recycling_container_type>("lock_queue", "recycling_list", thread_num, msg_num, msg_len);
+	test<mpsc_queue, container_type>("mpsc_queue", "list", thread_num, msg_num, msg_len);
+	test<mpsc_queue, recycling_container_type>("mpsc_queue", "recycling_list", thread_num, msg_num, msg_len);
+	if (1 == thread_num) //spsc_queue only supports one producer
+	{
+		test<spsc_queue, container_type>("spsc_queue", "list", thread_num, msg_num, msg_len);
+		test<spsc_queue, recycling_container_type>("spsc_queue", "recycling_list", thread_num, msg_num, msg_len);
+	}
+
+	return 0;
+}
@@ -0,0 +1,385 @@
+
+#include <iostream>
+
+//configuration
+//configuration
+
+#include <ascs/ext/unpacker.h>
+using namespace ascs;
+using namespace ascs::ext;
+
+//the original byte by byte implementation of prefix_suffix_unpacker::memmem, as the baseline.
+static const void* old_memmem(const void* mem, size_t len, const void* sub_mem, size_t sub_len)
+{
+	if (nullptr != mem && nullptr != sub_mem && sub_len <= len)
+	{
+		auto valid_len = len - sub_len;
+		for (size_t i = 0; i <= valid_len; ++i, mem = (const char*) mem + 1)
+			if (0 == memcmp(mem, sub_mem, sub_len))
+				return mem;
+	}
+
+	return nullptr;
+}
+
+static std::string make_msg(size_t msg_len, const std::string& suffix)
+{
+	std::string msg;
+	for (size_t i = 0; msg.size() + suffix.size() < msg_len; ++i)
+		msg.push_back("0123456789abcdefghijklmnopqrstuvwxyz ,.;"[i % 40]);
+
+	return msg + suffix;
+}
+
+static std::string printable(const std::string& suffix)
+{
+	std::string re;
+	for (auto c : suffix)
+		if ('\r' == c)
+			re += "\\r";
+		else if ('\n' == c)
+			re += "\\n";
+		else
+			re.push_back(c);
+
+	return re;
+}
+
+//search the suffix in a whole msg.
+template<typename MemMem>
+void test_memmem(const char* name, MemMem&& memmem_, const std::string& suffix, size_t msg_len, size_t loop_num)
+{
+	auto msg = make_msg(msg_len, suffix);
+	volatile size_t size = msg.size(); //prevent the compiler from hoisting the searching out of the loop
+	size_t found = 0;
+	cpu_timer begin_time;
+
+	for (size_t i = 0; i < loop_num; ++i)
+		if (nullptr != memmem_(msg.data(), size, suffix.data(), suffix.size()))
+			++found;
+
+	auto used_time = begin_time.elapsed();
+	printf("%-10s %-6s whole msg:    %f seconds, %.0f MB/s\n", name, printable(suffix).data(), used_time, found * msg.size() / used_time / 1024 / 1024);
+}
+
+//a msg arrives in segments (seg_len bytes each), the suffix is searched after every segment, just like what completion_condition does.
+//the old way rescans the msg from the beginning every time, the new way (prefix_suffix_unpacker) resumes from where it stopped.
+void test_segments_old(const std::string& suffix, size_t msg_len, size_t seg_len, size_t loop_num)
+{
+	auto msg = make_msg(msg_len, suffix);
+	volatile size_t size = msg.size(); //prevent the compiler from hoisting the searching out of the loop
+	size_t found = 0;
+	cpu_timer begin_time;
+
+	for (size_t i = 0; i < loop_num; ++i)
+		for (size_t received = std::min(seg_len, (size_t) size);; received = std::min(received + seg_len, (size_t) size))
+			if (nullptr != old_memmem(msg.data(), received, suffix.data(), suffix.size()))
+			{
+				++found;
+				break;
+			}
+
+	auto used_time = begin_time.elapsed();
+	printf("%-10s %-6s in segments:  %f seconds, %.0f msgs/s\n", "old", printable(suffix).data(), used_time, found / used_time);
+}
+
+void test_segments_new(const std::string& suffix, size_t msg_len, size_t seg_len, size_t loop_num)
+{
+	auto msg = make_msg(msg_len, suffix);
+	prefix_suffix_unpacker unpacker;
+	unpacker.prefix_suffix("", suffix);
+	prefix_suffix_unpacker::container_type msg_can;
+	asio::error_code ec;
+	size_t found = 0;
+	cpu_timer begin_time;
+
+	for (size_t i = 0; i < loop_num; ++i)
+	{
+		auto buff = (char*) unpacker.prepare_next_recv().data();
+		size_t received = 0;
+		do
+		{
+			auto len = std::min(seg_len, msg.size() - received);
+			memcpy(std::next(buff, received), std::next(msg.data(), received), len);
+			received += len;
+		} while (0 != unpacker.completion_condition(ec, received));
+
+		unpacker.parse_msg(received, msg_can);
+		found += msg_can.size();
+		msg_can.clear();
+	}
+
+	auto used_time = begin_time.elapsed();
+	printf("%-10s %-6s in segments:  %f seconds, %.0f msgs/s\n", "new", printable(suffix).data(), used_time, found / used_time);
+}
+
+//parse_msg alone, every read brings as many whole msgs (msg_len bytes each, head included) as the receive buffer can hold.
+//unpacker copies every msg out of its buffer, slab_unpacker doesn't, and it reuses its slab if all msgs of the previous read have been released,
+//otherwise (the msgs of the latest held_reads reads are still held), it must allocate a new slab for every read.
+template<typename Unpacker> void test_parse_msg(const char* name, size_t msg_len, size_t loop_num, size_t held_reads = 0)
+{
+	auto msg = make_msg(msg_len, "");
+	auto head = ASCS_HEAD_H2N((ASCS_HEAD_TYPE) msg_len);
+	memcpy(&msg.front(), &head, ASCS_HEAD_LEN);
+	std::string read_data;
+	while (read_data.size() + msg_len <= ASCS_MSG_BUFFER_SIZE)
+		read_data += msg;
+
+	Unpacker unpacker;
+	std::list<typename Unpacker::container_type> held_msgs;
+	typename Unpacker::container_type msg_can;
+	size_t parsed = 0, new_buff_num = 0;
+	const void* last_buff = nullptr;
+	cpu_timer begin_time;
+
+	for (size_t i = 0; i < loop_num; ++i)
+	{
+		auto buff = unpacker.prepare_next_recv();
+		if (buff.data() != last_buff)
+		{
+			last_buff = buff.data();
+			++new_buff_num;
+		}
+		memcpy(buff.data(), read_data.data(), read_data.size());
+		unpacker.parse_msg(read_data.size(), msg_can);
+
+		parsed += msg_can.size();
+		if (held_reads > 0)
+		{
+			held_msgs.emplace_back();
+			held_msgs.back().swap(msg_can);
+			if (held_msgs.size() > held_reads)
+				held_msgs.pop_front();
+		}
+		else
+			msg_can.clear();
+	}
+
+	auto used_time = begin_time.elapsed();
+	printf("%-32s %f seconds, %.0f msgs/s, " ASCS_SF " receive buffers\n", name, used_time, parsed / used_time, new_buff_num);
+}
+
+static bool check(bool ok, const char* what) {if (!ok) printf("%s failed.\n", what); return ok;}
+
+//length + body, just like what packer does.
+static std::string pack_msg(const std::string& body)
+{
+	auto head = ASCS_HEAD_H2N((ASCS_HEAD_TYPE) (ASCS_HEAD_LEN + body.size()));
+	return std::string((const char*) &head, ASCS_HEAD_LEN) + body;
+}
+
+//put len bytes into the unpacker's receive buffer and parse them, just like what tcp::socket_base does after every read.
+template<typename Unpacker> bool feed(Unpacker& unpacker, const char* data, size_t len, typename Unpacker::container_type& msg_can)
+{
+	auto buff = unpacker.prepare_next_recv();
+	assert(asio::buffer_size(buff) >= len);
+	memcpy((char*) buff.data(), data, len);
+
+	return unpacker.parse_msg(len, msg_can);
+}
+
+//feed len bytes in reads of read_len bytes.
+template<typename Unpacker> bool feed(Unpacker& unpacker, const char* data, size_t len, size_t read_len, typename Unpacker::container_type& msg_can)
+{
+	auto re = true;
+	for (size_t received = 0; re && received < len; received += read_len)
+		re = feed(unpacker, std::next(data, received), std::min(read_len, len - received), msg_can);
+
+	return re;
+}
+
+//all chunks at the front of msg_can must belong to the same big msg and make up body in order, only the last one is marked as last.
+static bool fetch_chunks(chunked_unpacker::container_type& msg_can, const std::string& body, uint_fast64_t& id)
+{
+	if (msg_can.empty() || !msg_can.front().is_chunk())
+		return false;
+
+	id = msg_can.front().id();
+	std::string data;
+	while (!msg_can.empty() && msg_can.front().is_chunk())
+	{
+		auto& chunk = msg_can.front();
+		if (id != chunk.id() || data.size() != chunk.offset() || (data.size() + chunk.size() == body.size()) != chunk.last())
+			return false;
+
+		data += chunk;
+		msg_can.pop_front();
+	}
+
+	return data == body;
+}
+
+bool test_chunked_unpacker()
+{
+	auto re = true;
+	chunked_unpacker unpacker;
+	chunked_unpacker::container_type msg_can;
+	auto big_body = make_msg(ASCS_MSG_BUFFER_SIZE * 2 + 100, ""), small_body = make_msg(100, "");
+	auto big_msg = pack_msg(big_body), small_msg = pack_msg(small_body);
+	uint_fast64_t id = 0, last_id = 0;
+
+	//a big msg split across reads
+	re &= check(feed(unpacker, big_msg.data(), big_msg.size(), 1000, msg_can), "chunked_unpacker: parsing a big msg split across reads");
+	re &= check(fetch_chunks(msg_can, big_body, id) && msg_can.empty(), "chunked_unpacker: delivering a big msg split across reads");
+
+	//a small msg right after a big one in the same read
+	auto stream = big_msg + small_msg;
+	auto len = big_msg.size() - 500;
+	last_id = id;
+	re &= check(feed(unpacker, stream.data(), len, 1000, msg_can) && feed(unpacker, std::next(stream.data(), len), stream.size() - len, msg_can),
+		"chunked_unpacker: parsing a small msg right after a big one in the same read");
+	re &= check(fetch_chunks(msg_can, big_body, id) && id != last_id && 1 == msg_can.size() && !msg_can.front().is_chunk() && small_body == msg_can.front(),
+		"chunked_unpacker: delivering a small msg right after a big one in the same read");
+	msg_can.clear();
+
+	//the head of a big msg arrives alone
+	last_id = id;
+	re &= check(feed(unpacker, big_msg.data(), ASCS_HEAD_LEN, msg_can) && msg_can.empty() && (size_t) -1 == unpacker.current_msg_length(),
+		"chunked_unpacker: parsing the head of a big msg which arrived alone");
+	re &= check(feed(unpacker, std::next(big_msg.data(), ASCS_HEAD_LEN), big_msg.size() - ASCS_HEAD_LEN, 1000, msg_can),
+		"chunked_unpacker: parsing the body after the head of a big msg arrived alone");
+	re &= check(fetch_chunks(msg_can, big_body, id) && id != last_id && msg_can.empty(), "chunked_unpacker: delivering a big msg whose head arrived alone");
+
+	if (re)
+		puts("chunked_unpacker: all tests passed.");
+	return re;
+}
+
+//join all msgs in msg_can and clear it.
+template<typename Container> std::string fetch_msgs(Container& msg_can)
+{
+	std::string data;
+	for (auto& msg : msg_can)
+		data.append(msg.data(), msg.size());
+	msg_can.clear();
+
+	return data;
+}
+
+bool test_batch_fixed_length_unpacker()
+{
+	auto re = true;
+	batch_fixed_length_unpacker unpacker;
+	batch_fixed_length_unpacker::container_type msg_can;
+	auto stream = make_msg(ASCS_MSG_BUFFER_SIZE, "");
+	auto pnext = stream.data();
+
+	//the partial tail is kept for the next read
+	unpacker.fixed_length(64);
+	re &= check(feed(unpacker, pnext, 64 * 3 + 10, msg_can) && 3 == msg_can.size() && fetch_msgs(msg_can) == std::string(pnext, 64 * 3),
+		"batch_fixed_length_unpacker: slicing msgs with a partial tail");
+	std::advance(pnext, 64 * 3);
+	re &= check(feed(unpacker, std::next(pnext, 10), 54, msg_can) && 1 == msg_can.size() && fetch_msgs(msg_can) == std::string(pnext, 64),
+		"batch_fixed_length_unpacker: completing the partial tail");
+	std::advance(pnext, 64);
+
+	//the non-copy path starts from non_copy_threshold, but only when no partial tail left behind
+	unpacker.fixed_length(100);
+	unpacker.non_copy_threshold(200);
+	re &= check(feed(unpacker, pnext, 150, msg_can) && fetch_msgs(msg_can) == std::string(pnext, 100), "batch_fixed_length_unpacker: slicing msgs below non_copy_threshold");
+	std::advance(pnext, 100);
+	unpacker.fixed_length(200);
+	re &= check(asio::buffer_size(unpacker.prepare_next_recv()) == ASCS_MSG_BUFFER_SIZE - 50, "batch_fixed_length_unpacker: keeping the copy path with a partial tail");
+	re &= check(feed(unpacker, std::next(pnext, 50), 150, msg_can) && fetch_msgs(msg_can) == std::string(pnext, 200),
+		"batch_fixed_length_unpacker: completing the partial tail before switching to the non-copy path");
+	std::advance(pnext, 200);
+	re &= check(200 == asio::buffer_size(unpacker.prepare_next_recv()), "batch_fixed_length_unpacker: switching to the non-copy path at non_copy_threshold");
+	re &= check(feed(unpacker, pnext, 200, msg_can) && fetch_msgs(msg_can) == std::string(pnext, 200), "batch_fixed_length_unpacker: receiving a msg via the non-copy path");
+	std::advance(pnext, 200);
+	unpacker.fixed_length(199);
+	re &= check(ASCS_MSG_BUFFER_SIZE == asio::buffer_size(unpacker.prepare_next_recv()), "batch_fixed_length_unpacker: switching back to the copy path below non_copy_threshold");
+	re &= check(feed(unpacker, pnext, 199, msg_can) && fetch_msgs(msg_can) == std::string(pnext, 199), "batch_fixed_length_unpacker: receiving a msg via the copy path again");
+	std::advance(pnext, 199);
+
+	//read-some mode, incomplete msgs are not errors
+	re &= check(!feed(unpacker, pnext, 100, msg_can) && msg_can.empty(), "batch_fixed_length_unpacker: rejecting an incomplete msg without read-some mode");
+	unpacker.reset();
+	unpacker.read_some(true);
+	re &= check(feed(unpacker, pnext, 100, msg_can) && msg_can.empty(), "batch_fixed_length_unpacker: accepting an incomplete msg in read-some mode");
+	re &= check(feed(unpacker, std::next(pnext, 100), 99, msg_can) && fetch_msgs(msg_can) == std::string(pnext, 199),
+		"batch_fixed_length_unpacker: completing an incomplete msg in read-some mode");
+	std::advance(pnext, 199);
+	unpacker.fixed_length(200);
+	re &= check(feed(unpacker, pnext, 150, msg_can) && msg_can.empty(), "batch_fixed_length_unpacker: accepting an incomplete non-copy msg in read-some mode");
+	re &= check(feed(unpacker, std::next(pnext, 150), 50, msg_can) && fetch_msgs(msg_can) == std::string(pnext, 200),
+		"batch_fixed_length_unpacker: completing an incomplete non-copy msg in read-some mode");
+
+	if (re)
+		puts("batch_fixed_length_unpacker: all tests passed.");
+	return re;
+}
+
+bool test_hybrid_unpacker(bool stripped)
+{
+	auto re = true;
+	hybrid_unpacker unpacker;
+	hybrid_unpacker::container_type msg_can;
+	unpacker.stripped(stripped);
+	auto big_body = make_msg(ASCS_STAGING_BUFFER_SIZE * 2, ""), small_body = make_msg(100, "");
+	auto big_msg = pack_msg(big_body), small_msg = pack_msg(small_body);
+	auto skip_len = stripped ? ASCS_HEAD_LEN : 0;
+	auto stream = small_msg + big_msg + small_msg;
+	std::string what = stripped ? "hybrid_unpacker (stripped): " : "hybrid_unpacker (unstripped): ";
+
+	//a small msg, then the head of a big msg and part of its body are staged in the same read
+	auto len = small_msg.size() + ASCS_HEAD_LEN + 100;
+	re &= check(feed(unpacker, stream.data(), len, msg_can) && fetch_msgs(msg_can) == small_msg.substr(skip_len),
+		(what + "parsing a small msg followed by a staged big msg head").data());
+	re &= check(asio::buffer_size(unpacker.prepare_next_recv()) == big_msg.size() - ASCS_HEAD_LEN - 100, (what + "reading the rest of a big msg directly").data());
+	re &= check(feed(unpacker, std::next(stream.data(), len), big_msg.size() - ASCS_HEAD_LEN - 100, msg_can) && fetch_msgs(msg_can) == big_msg.substr(skip_len),
+		(what + "delivering a big msg whose head was staged").data());
+
+	//back to the staging buffer after the big msg
+	len = small_msg.size() + big_msg.size();
+	re &= check(feed(unpacker, std::next(stream.data(), len), stream.size() - len, msg_can) && fetch_msgs(msg_can) == small_msg.substr(skip_len),
+		(what + "parsing a small msg right after a big one").data());
+
+	//only the head of a big msg is staged
+	re &= check(feed(unpacker, big_msg.data(), ASCS_HEAD_LEN, msg_can) && msg_can.empty(), (what + "staging the head of a big msg which arrived alone").data());
+	re &= check(asio::buffer_size(unpacker.prepare_next_recv()) == big_msg.size() - ASCS_HEAD_LEN, (what + "reading the whole body of a big msg directly").data());
+	re &= check(feed(unpacker, std::next(big_msg.data(), ASCS_HEAD_LEN), big_msg.size() - ASCS_HEAD_LEN, msg_can) && fetch_msgs(msg_can) == big_msg.substr(skip_len),
+		(what + "delivering a big msg whose head arrived alone").data());
+
+	if (re)
+		printf("%sall tests passed.\n", what.data());
+	return re;
+}
+
+int main(int argc, const char* argv[])
+{
+	printf("usage: %s [<message length=1024> [<segment length=64> [<loop number=100000>]]]\n", argv[0]);
+	if (argc >= 2 && (0 == strcmp(argv[1], "--help") || 0 == strcmp(argv[1], "-h")))
+		return 0;
+
+	size_t msg_len = 1024, seg_len = 64, loop_num = 100000;
+	if (argc > 1)
+		msg_len = std::min(std::max(atoi(argv[1]), 4), ASCS_MSG_BUFFER_SIZE - 1);
+	if (argc > 2)
+		seg_len = std::max(atoi(argv[2]), 1);
+	if (argc > 3)
+		loop_num = std::max(atoi(argv[3]), 1);
+
+	if (!test_chunked_unpacker() || !test_batch_fixed_length_unpacker() || !test_hybrid_unpacker(true) || !test_hybrid_unpacker(false))
+		return 1;
+
+#ifdef ASCS_SIMD_WIDTH
+	printf("SIMD width: %d bytes\n", ASCS_SIMD_WIDTH);
+#else
+	puts("SIMD is not available.");
+#endif
+	const char* suffixes[] = {"\n", "\r\n", "end"};
+	for (auto suffix : suffixes)
+	{
+		test_memmem("old", old_memmem, suffix, msg_len, loop_num);
+		test_memmem("new", prefix_suffix_unpacker::memmem, suffix, msg_len, loop_num);
+		test_segments_old(suffix, msg_len, seg_len, loop_num);
+		test_segments_new(suffix, msg_len, seg_len, loop_num);
+	}
+
+	test_parse_msg<unpacker>("unpacker", msg_len, loop_num);
+	test_parse_msg<slab_unpacker>("slab_unpacker (slab reused)", msg_len, loop_num);
+	test_parse_msg<slab_unpacker>("slab_unpacker (1 read held)", msg_len, loop_num, 1);
+	test_parse_msg<slab_unpacker>("slab_unpacker (16 reads held)", msg_len, loop_num, 16);
+
+	return 0;
+}
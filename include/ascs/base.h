@@ -26,14 +26,21 @@
 #include <atomic>
 #include <sstream>
 #include <iomanip>
+#include <condition_variable>
 #ifdef ASCS_SYNC_SEND
 #include <future>
-#elif defined(ASCS_SYNC_RECV)
-#include <condition_variable>
 #endif
 
 #include <asio.hpp>
 
+#ifdef ASCS_FILE_REGION
+#ifdef _MSC_VER
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#endif
+
 #include "config.h"
 
 namespace ascs
@@ -94,6 +101,67 @@ public:
 	virtual const char* data() const = 0;
 };
 
+#ifdef ASCS_FILE_REGION
+//a region (offset, length) of a file, wrap it by auto_buffer or shared_buffer and send it via direct_send_msg (only tcp), then
+//tcp::socket_base will transmit it by sendfile(2) if possible (plain tcp sockets on linux), otherwise (ssl for example),
+//it will be read into a buffer chunk by chunk and then sent, which is just like file_buffer in demo file_server.
+//the file descriptor is not owned by file_region, keep it opened until the region has been sent (see on_msg_send).
+//like other msgs, data() and size() describe what's in the memory, which is the chunk read by read_chunk (so a file region will not be counted
+//in the send buffer's size), the region's length can be got via length(), and empty() returns true only if the length is zero.
+class file_region : public i_buffer
+{
+public:
+#ifdef _MSC_VER
+	typedef __int64 offset_type;
+#else
+	typedef off_t offset_type;
+#endif
+
+	file_region(int fd_, offset_type offset_, size_t length_) : _fd(fd_), _offset(offset_), _length(length_), transferred(0) {}
+
+public:
+	virtual bool empty() const {return 0 == _length;}
+	virtual size_t size() const {return chunk.size();}
+	virtual const char* data() const {return chunk.data();}
+
+	int fd() const {return _fd;}
+	size_t length() const {return _length;}
+	offset_type offset() const {return _offset + (offset_type) transferred;} //where to transmit next
+	size_t remain() const {return _length - transferred;}
+	void consume(size_t len) {assert(len <= remain()); transferred += len;}
+
+	//read the next chunk (at offset()) into the internal buffer, return its length, 0 means error (errno is zero if the file has been truncated)
+	//or the region has been completely transferred, used when sendfile(2) is not available.
+	size_t read_chunk()
+	{
+		auto len = remain() > asio::detail::default_max_transfer_size ? asio::detail::default_max_transfer_size : remain();
+		chunk.resize(len);
+		if (0 == len)
+			return 0;
+
+		errno = 0;
+#ifdef _MSC_VER
+		if (_lseeki64(_fd, offset(), SEEK_SET) < 0 || (int) len != _read(_fd, &chunk.front(), (unsigned) len))
+#else
+		if ((ssize_t) len != pread(_fd, &chunk.front(), len, offset()))
+#endif
+			chunk.clear();
+
+		return chunk.size();
+	}
+
+protected:
+	int _fd;
+	offset_type _offset;
+	size_t _length, transferred;
+
+	std::string chunk;
+};
+
+//file region detection, only messages which hold i_buffer (auto_buffer<i_buffer> or shared_buffer<i_buffer>) can be file regions.
+template<typename T> inline file_region* to_file_region(const T&) {return nullptr;}
+#endif
+
 //convert '->' operation to '.' operation
 //user need to allocate object, and auto_buffer will free it
 template<typename T> class auto_buffer
@@ -126,6 +194,10 @@ protected:
 	buffer_type buffer;
 };
 
+#ifdef ASCS_FILE_REGION
+inline file_region* to_file_region(const auto_buffer<i_buffer>& msg) {return dynamic_cast<file_region*>(msg.raw_buffer());}
+#endif
+
 //convert '->' operation to '.' operation
 //user need to allocate object, and shared_buffer will free it
 //not like auto_buffer, shared_buffer is copyable (seemingly), but auto_buffer is a bit more efficient.
@@ -159,6 +231,10 @@ protected:
 	buffer_type buffer;
 };
 
+#ifdef ASCS_FILE_REGION
+inline file_region* to_file_region(const shared_buffer<i_buffer>& msg) {return dynamic_cast<file_region*>(msg.raw_buffer().get());}
+#endif
+
 //ascs requires that container must take one and only one template argument
 template<typename T> using list = std::list<T>;
 
@@ -215,8 +291,15 @@ public:
 	bool stripped() const {return _stripped;}
 	void stripped(bool stripped_) {_stripped = stripped_;}
 
+	//read-some mode, tcp::socket_base will use async_read_some instead of asio::async_read, so completion_condition will not be called any more,
+	//and parse_msg will be called after every read with whatever data received, it must return true if no msg is available yet but the data is valid.
+	//this mode saves condition callbacks and handler hops on high-rate small-message links, but not every unpacker supports it (for example,
+	//non_copy_unpacker and fixed_length_unpacker don't support it), please note. this mode is ignored by udp.
+	bool read_some() const {return _read_some;}
+	void read_some(bool read_some_) {_read_some = read_some_;}
+
 protected:
-	i_unpacker() : _stripped(true) {}
+	i_unpacker() : _stripped(true), _read_some(false) {}
 	virtual ~i_unpacker() {}
 
 public:
@@ -227,7 +310,7 @@ public:
 	virtual buffer_type prepare_next_recv() = 0;
 
 private:
-	bool _stripped;
+	bool _stripped, _read_some;
 };
 
 namespace udp
@@ -325,6 +408,9 @@ struct statistic
 	void reset_number()
 	{
 		send_msg_sum = 0;
+		expired_msg_sum = 0;
+		zerocopy_msg_sum = 0;
+		zerocopy_copied_sum = 0;
 		send_byte_sum = 0;
 
 		recv_msg_sum = 0;
@@ -357,6 +443,9 @@ struct statistic
 	statistic& operator+=(const struct statistic& other)
 	{
 		send_msg_sum += other.send_msg_sum;
+		expired_msg_sum += other.expired_msg_sum;
+		zerocopy_msg_sum += other.zerocopy_msg_sum;
+		zerocopy_copied_sum += other.zerocopy_copied_sum;
 		send_byte_sum += other.send_byte_sum;
 		send_delay_sum += other.send_delay_sum;
 		send_time_sum += other.send_time_sum;
@@ -383,6 +472,9 @@ struct statistic
 	statistic& operator-=(const struct statistic& other)
 	{
 		send_msg_sum -= other.send_msg_sum;
+		expired_msg_sum -= other.expired_msg_sum;
+		zerocopy_msg_sum -= other.zerocopy_msg_sum;
+		zerocopy_copied_sum -= other.zerocopy_copied_sum;
 		send_byte_sum -= other.send_byte_sum;
 		send_delay_sum -= other.send_delay_sum;
 		send_time_sum -= other.send_time_sum;
@@ -410,6 +502,10 @@ struct statistic
 	{
 		std::ostringstream s;
 		s << "send corresponding statistic:\nmessage sum: " << send_msg_sum << std::endl << "size in bytes: " << send_byte_sum << std::endl
+			<< "expired message sum: " << expired_msg_sum << std::endl
+#ifdef ASCS_ZEROCOPY_THRESHOLD
+			<< "zero copy message sum: " << zerocopy_msg_sum << std::endl << "zero copy fell back to copying: " << zerocopy_copied_sum << std::endl
+#endif
 #ifdef ASCS_FULL_STATISTIC
 			<< "send delay: " << send_delay_sum << std::endl << "send duration: " << send_time_sum << std::endl << "pack duration: " << pack_time_sum << std::endl
 #endif
@@ -423,6 +519,9 @@ struct statistic
 
 	//send corresponding statistic
 	uint_fast64_t send_msg_sum; //not counted msgs in sending buffer
+	uint_fast64_t expired_msg_sum; //msgs dropped before sending because of ttl, see macro ASCS_MSG_TTL
+	uint_fast64_t zerocopy_msg_sum; //msgs sent with MSG_ZEROCOPY, see macro ASCS_ZEROCOPY_THRESHOLD
+	uint_fast64_t zerocopy_copied_sum; //zero copy sends which the kernel fell back to copying (reported by the error queue)
 	uint_fast64_t send_byte_sum; //include data added by packer, not counted msgs in sending buffer
 	stat_duration send_delay_sum; //from send_(native_)msg (exclude msg packing) to asio::async_write
 	stat_duration send_time_sum; //from asio::async_write to send_handler
@@ -458,28 +557,79 @@ private:
 	statistic::stat_duration& duration;
 };
 
+//byte budget shared by buffers of many sockets, see macro ASCS_SEND_BUF_BUDGET and ASCS_RECV_BUF_BUDGET for more details.
+class buffer_budget : public asio::noncopyable
+{
+public:
+	buffer_budget(size_t capacity_) : _capacity(capacity_), _usage(0) {}
+
+	void capacity(size_t capacity_) {_capacity = capacity_;}
+	size_t capacity() const {return _capacity;}
+	size_t usage() const {return _usage;}
+	bool is_available() const {return _usage < _capacity;}
+
+	//buffers report how many bytes they gained or lost (not their sizes), so no buffer needs to be read (or locked) for reporting.
+	//growth is reported before the bytes can be taken out of the buffer, so shrinkage never makes usage underflow.
+	void grow(size_t size) {_usage.fetch_add(size, std::memory_order_relaxed);}
+	void shrink(size_t size) {_usage.fetch_sub(size, std::memory_order_relaxed);}
+
+private:
+	std::atomic_size_t _capacity, _usage;
+};
+
+#ifdef ASCS_SEND_BUF_BUDGET
+inline buffer_budget& send_buffer_budget() {static buffer_budget budget(ASCS_SEND_BUF_BUDGET); return budget;}
+#endif
+#ifdef ASCS_RECV_BUF_BUDGET
+inline buffer_budget& recv_buffer_budget() {static buffer_budget budget(ASCS_RECV_BUF_BUDGET); return budget;}
+#endif
+
 enum sync_call_result {SUCCESS, NOT_APPLICABLE, DUPLICATE, TIMEOUT};
 
 template<typename T> struct obj_with_begin_time : public T
 {
-	obj_with_begin_time() {}
-	obj_with_begin_time(const T& obj) : T(obj) {restart();}
-	obj_with_begin_time(T&& obj) : T(std::move(obj)) {restart();}
-	obj_with_begin_time& operator=(const T& obj) {T::operator=(obj); restart(); return *this;}
-	obj_with_begin_time& operator=(T&& obj) {T::operator=(std::move(obj)); restart(); return *this;}
-	obj_with_begin_time(const obj_with_begin_time& other) : T(other), begin_time(other.begin_time) {}
-	obj_with_begin_time(obj_with_begin_time&& other) : T(std::move(other)), begin_time(std::move(other.begin_time)) {}
-	obj_with_begin_time& operator=(const obj_with_begin_time& other) {T::operator=(other); begin_time = other.begin_time; return *this;}
-	obj_with_begin_time& operator=(obj_with_begin_time&& other) {T::operator=(std::move(other)); begin_time = std::move(other.begin_time); return *this;}
+	obj_with_begin_time() : more_pieces(false) {}
+	obj_with_begin_time(const T& obj) : T(obj), more_pieces(false) {restart(); stamp();}
+	obj_with_begin_time(T&& obj) : T(std::move(obj)), more_pieces(false) {restart(); stamp();}
+	obj_with_begin_time& operator=(const T& obj) {T::operator=(obj); restart(); stamp(); more_pieces = false; return *this;}
+	obj_with_begin_time& operator=(T&& obj) {T::operator=(std::move(obj)); restart(); stamp(); more_pieces = false; return *this;}
+	obj_with_begin_time(const obj_with_begin_time& other) : T(other), begin_time(other.begin_time), more_pieces(other.more_pieces) {copy_stamp(other);}
+	obj_with_begin_time(obj_with_begin_time&& other) : T(std::move(other)), begin_time(std::move(other.begin_time)), more_pieces(other.more_pieces) {copy_stamp(other);}
+	obj_with_begin_time& operator=(const obj_with_begin_time& other)
+		{T::operator=(other); begin_time = other.begin_time; more_pieces = other.more_pieces; copy_stamp(other); return *this;}
+	obj_with_begin_time& operator=(obj_with_begin_time&& other)
+		{T::operator=(std::move(other)); begin_time = std::move(other.begin_time); more_pieces = other.more_pieces; copy_stamp(other); return *this;}
 
 	void restart() {restart(statistic::now());}
 	void restart(const typename statistic::stat_time& begin_time_) {begin_time = begin_time_;}
-	void swap(T& obj) {T::swap(obj); restart();}
-	void swap(obj_with_begin_time& other) {T::swap(other); std::swap(begin_time, other.begin_time);}
+	void swap(T& obj) {T::swap(obj); restart(); stamp(); more_pieces = false;}
+	void swap(obj_with_begin_time& other) {T::swap(other); std::swap(begin_time, other.begin_time); std::swap(more_pieces, other.more_pieces); swap_stamp(other);}
 
-	void clear() {T::clear(); begin_time = typename statistic::stat_time();}
+	void clear() {T::clear(); begin_time = typename statistic::stat_time(); more_pieces = false;}
 
 	typename statistic::stat_time begin_time;
+	bool more_pieces; //more pieces of the same message follow this one, lane_queue will not switch lanes between them
+
+#ifdef ASCS_MSG_TTL
+	//unlike begin_time, the enqueue time is always a real time point (it's not affected by macro ASCS_FULL_STATISTIC), and restart() will not change it.
+	typedef std::chrono::steady_clock::time_point ttl_time;
+
+	void stamp() {stamp(std::chrono::steady_clock::now());}
+	void stamp(const ttl_time& enqueue_time_) {enqueue_time = enqueue_time_;}
+	bool expired(const ttl_time& now, unsigned ttl) const {return ttl > 0 && now - enqueue_time >= std::chrono::milliseconds(ttl);}
+
+	ttl_time enqueue_time;
+
+private:
+	void copy_stamp(const obj_with_begin_time& other) {enqueue_time = other.enqueue_time;}
+	void swap_stamp(obj_with_begin_time& other) {std::swap(enqueue_time, other.enqueue_time);}
+#else
+	void stamp() {}
+
+private:
+	void copy_stamp(const obj_with_begin_time&) {}
+	void swap_stamp(obj_with_begin_time&) {}
+#endif
 };
 
 #ifdef ASCS_SYNC_SEND
@@ -505,6 +655,10 @@ template<typename T> struct obj_with_begin_time_promise : public obj_with_begin_
 };
 #endif
 
+//append a message into a buffer sequence (for example, std::vector<asio::const_buffer>), tcp::socket_base uses this function to build buffers.
+//if a message consists of discontinuous parts (like ext::inline_header_msg), provide an overload in the message's namespace (found by ADL).
+template<typename Buffers, typename T> inline void append_buffers(Buffers& buffers, const T& msg) {buffers.emplace_back(msg.data(), msg.size());}
+
 //free functions, used to do something to any container(except map and multimap) optionally with any mutex
 template<typename _Can, typename _Mutex, typename _Predicate>
 void do_something_to_all(_Can& __can, _Mutex& __mutex, const _Predicate& __pred) {std::lock_guard<std::mutex> lock(__mutex); for (auto& item : __can) __pred(item);}
@@ -564,16 +718,10 @@ template<typename _Predicate> void NAME(const _Predicate& __pred) const {for (au
 #define SAFE_SEND_MSG_CHECK(F_VALUE) \
 { \
 	if (!is_ready()) return F_VALUE; \
-	std::this_thread::sleep_for(std::chrono::milliseconds(50)); \
+	this->wait_send_buffer_writable(50); \
 }
 
 #define GET_PENDING_MSG_SIZE(FUNNAME, CAN) size_t FUNNAME() const {return CAN.size_in_byte();}
-#define POP_FIRST_PENDING_MSG(FUNNAME, CAN, MSGTYPE) void FUNNAME(MSGTYPE& msg) {msg.clear(); CAN.try_dequeue(msg);}
-#define POP_FIRST_PENDING_MSG_NOTIFY(FUNNAME, CAN, MSGTYPE) void FUNNAME(MSGTYPE& msg) \
-	{msg.clear(); if (CAN.try_dequeue(msg) && msg.p) msg.p->set_value(sync_call_result::NOT_APPLICABLE);}
-#define POP_ALL_PENDING_MSG(FUNNAME, CAN, CANTYPE) void FUNNAME(CANTYPE& can) {can.clear(); CAN.swap(can);}
-#define POP_ALL_PENDING_MSG_NOTIFY(FUNNAME, CAN, CANTYPE) void FUNNAME(CANTYPE& can) \
-	{can.clear(); CAN.swap(can); ascs::do_something_to_all(can, [](typename CANTYPE::reference msg) {if (msg.p) msg.p->set_value(sync_call_result::NOT_APPLICABLE);});}
 
 ///////////////////////////////////////////////////
 //TCP msg sending interface
@@ -642,10 +790,72 @@ bool FUNNAME(const char* const pstr[], const size_t len[], size_t num, bool can_
 	{while (!SEND_FUNNAME(pstr, len, num, can_overflow)) SAFE_SEND_MSG_CHECK(false) return true;} \
 TCP_SEND_MSG_CALL_SWITCH(FUNNAME, bool)
 
+//put the packed msg into the given lane of the send buffer, see macro ASCS_SEND_LANE_NUM for more details.
+#define TCP_SEND_PRIORITY_MSG(FUNNAME, NATIVE) \
+bool FUNNAME(size_t priority, const char* const pstr[], const size_t len[], size_t num, bool can_overflow = false) \
+{ \
+	if (!can_overflow && !this->is_send_buffer_available()) \
+		return false; \
+	auto_duration dur(stat.pack_time_sum); \
+	auto msg = packer_->pack_msg(pstr, len, num, NATIVE); \
+	dur.end(); \
+	return do_direct_send_msg(std::move(msg), priority); \
+} \
+bool FUNNAME(size_t priority, const char* pstr, size_t len, bool can_overflow = false) {return FUNNAME(priority, &pstr, &len, 1, can_overflow);} \
+template<typename Buffer> bool FUNNAME(size_t priority, const Buffer& buffer, bool can_overflow = false) \
+	{return FUNNAME(priority, buffer.data(), buffer.size(), can_overflow);}
+
 #define TCP_BROADCAST_MSG(FUNNAME, SEND_FUNNAME) \
 void FUNNAME(const char* const pstr[], const size_t len[], size_t num, bool can_overflow = false) \
 	{this->do_something_to_all([=](typename Pool::object_ctype& item) {item->SEND_FUNNAME(pstr, len, num, can_overflow);});} \
 TCP_SEND_MSG_CALL_SWITCH(FUNNAME, void)
+
+//pack the msg only once (with any socket's packer, so all sockets must use the same protocol), then put copies of the packed msg into all sockets'
+//send buffers directly, if the packer's msg_type is reference counted (for example, packer2<shared_buffer<i_buffer>>), all sockets will share
+//the same payload (no more memory allocation and replication), otherwise, only packing will be saved. msg_type must be copyable (auto_buffer is not).
+#define TCP_BROADCAST_SHARED_MSG(FUNNAME, NATIVE) \
+void FUNNAME(const char* const pstr[], const size_t len[], size_t num, bool can_overflow = false) \
+{ \
+	typename Pool::object_type socket_ptr; \
+	this->do_something_to_one([&socket_ptr](typename Pool::object_ctype& item) {socket_ptr = item; return true;}); \
+	if (!socket_ptr) \
+		return; \
+\
+	auto msg = socket_ptr->packer()->pack_msg(pstr, len, num, NATIVE); \
+	if (msg.empty()) \
+		unified_out::error_out("found an empty message, please check your packer."); \
+	else \
+		this->do_something_to_all([&](typename Pool::object_ctype& item) {auto msg_copy(msg); item->direct_send_msg(std::move(msg_copy), can_overflow);}); \
+} \
+TCP_SEND_MSG_CALL_SWITCH(FUNNAME, void)
+
+//like TCP_BROADCAST_SHARED_MSG, but object_pool's lock will not be held during the broadcasting, and sockets will be handled in service threads
+//in parallel (see object_pool::parallel_do_something_to_all), on_complete (if any) will be invoked after all sockets accepted (or refused) the msg.
+#define TCP_PARALLEL_BROADCAST_MSG(FUNNAME, NATIVE) \
+void FUNNAME(const char* const pstr[], const size_t len[], size_t num, const std::function<void()>& on_complete, bool can_overflow = false) \
+{ \
+	typename Pool::object_type socket_ptr; \
+	this->do_something_to_one([&socket_ptr](typename Pool::object_ctype& item) {socket_ptr = item; return true;}); \
+	if (!socket_ptr) \
+	{ \
+		if (on_complete) \
+			on_complete(); \
+		return; \
+	} \
+\
+	auto msg = socket_ptr->packer()->pack_msg(pstr, len, num, NATIVE); \
+	if (msg.empty()) \
+	{ \
+		unified_out::error_out("found an empty message, please check your packer."); \
+		if (on_complete) \
+			on_complete(); \
+	} \
+	else \
+		this->parallel_do_something_to_all([=](typename Pool::object_ctype& item) {auto msg_copy(msg); item->direct_send_msg(std::move(msg_copy), can_overflow);}, on_complete); \
+} \
+void FUNNAME(const char* pstr, size_t len, const std::function<void()>& on_complete, bool can_overflow = false) {FUNNAME(&pstr, &len, 1, on_complete, can_overflow);} \
+template<typename Buffer> void FUNNAME(const Buffer& buffer, const std::function<void()>& on_complete, bool can_overflow = false) \
+	{FUNNAME(buffer.data(), buffer.size(), on_complete, can_overflow);}
 //TCP msg sending interface
 ///////////////////////////////////////////////////
 
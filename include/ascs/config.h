@@ -595,6 +595,63 @@
  *
  * REPLACEMENTS:
  *
+ * ===============================================================
+ * 2019.12.1	version 1.4.4
+ *
+ * SPECIAL ATTENTION (incompatible with old editions):
+ * Timer TIMER_CHECK_RECV has been removed, so the values of TIMER_DISPATCH_MSG, TIMER_DELAY_CLOSE and TIMER_HEARTBEAT_CHECK changed.
+ *
+ * HIGHLIGHT:
+ *
+ * FIX:
+ * Fix message lost when re-dispatching a message (on_msg_handle returned false) without ASCS_DISPATCH_BATCH_MSG.
+ *
+ * ENHANCEMENTS:
+ * Introduce lock-free multiple producers and single consumer queue mpsc_queue, it can be used as the send buffer (ASCS_INPUT_QUEUE).
+ * Introduce single producer and single consumer ring buffer queue spsc_queue, it can be used as the receive buffer (ASCS_OUTPUT_QUEUE).
+ * Introduce recycling_allocator and recycling_list, it can be used as the container of queues (ASCS_INPUT_CONTAINER and ASCS_OUTPUT_CONTAINER).
+ * Introduce high / low watermark to the send buffer, safe_send_(native_)msg now will be woken up as soon as the send buffer drained below the low watermark
+ *  (ASCS_SEND_BUF_LOW_WATERMARK) rather than sleeping 50 milliseconds, and ascs::socket::on_send_buffer_writable will be invoked at the same time.
+ * Message receiving now will be resumed by message dispatching (or pop_first/all_pending_recv_msg) as soon as the recv buffer drained below
+ *  the low watermark (ASCS_RECV_BUF_LOW_WATERMARK) rather than polling the recv buffer every 50 milliseconds by a timer.
+ * Introduce ascs::socket::defer_dispatch and resume_dispatch, on_msg_handle can defer message dispatching and resume it later at any time,
+ *  rather than being retried after msg_handling_interval milliseconds.
+ * Introduce process-wide budgets of all send buffers and all recv buffers, see macro ASCS_SEND_BUF_BUDGET and ASCS_RECV_BUF_BUDGET for more details.
+ * Support coalescing small messages before sending in tcp::socket_base, see macro ASCS_SEND_COALESCING_THRESHOLD for more details.
+ * Support send corking in tcp::socket_base, see macro ASCS_CORK_DELAY and ASCS_CORK_THRESHOLD for more details.
+ * Add broadcast_shared_msg and broadcast_shared_native_msg to tcp::server_base and tcp::multi_client_base, they pack the message only once,
+ *  and share the payload between all sockets if the packer's msg_type is reference counted (for example, shared_buffer<i_buffer>).
+ * Add object_pool::parallel_do_something_to_all, it traverses a snapshot of all objects in service threads in parallel with a completion callback.
+ * Add parallel_broadcast_msg and parallel_broadcast_native_msg to tcp::server_base and tcp::multi_client_base, they don't hold object_pool's lock
+ *  during broadcasting (see parallel_do_something_to_all) and pack the message only once (see broadcast_shared_msg).
+ * Support priority lanes in the send buffer, see macro ASCS_SEND_LANE_NUM for more details.
+ * Support dropping outbound messages which stayed in the send buffer too long, see macro ASCS_MSG_TTL.
+ * Support batched send notification (tcp::socket_base::on_msgs_send) which keeps multiple messages per write, see macro ASCS_WANT_BATCH_MSG_SEND_NOTIFY.
+ * Support sending file regions via sendfile(2) in tcp::socket_base, see macro ASCS_FILE_REGION and class file_region.
+ * Support MSG_ZEROCOPY for big messages in tcp::socket_base on linux, see macro ASCS_ZEROCOPY_THRESHOLD.
+ * Add inline_header_packer and inline_header_msg, which store the length header inline, so no memory allocation is needed for headers.
+ * Messages can consist of discontinuous buffers in tcp::socket_base, see function append_buffers.
+ * Add ring_unpacker, which uses a ring buffer and real scatter-gather buffers to avoid moving half-baked messages, see macro ASCS_SCATTERED_RECV_BUFFER.
+ * Unpackers can borrow their receive buffers from a process-wide pool only when needed, idle sockets use a small stub buffer instead,
+ *  see macro ASCS_POOLED_RECV_BUFFER for more details.
+ * Add chunked_unpacker, msg_chunk and ext::tcp::chunked_socket, msgs bigger than ASCS_MSG_BUFFER_SIZE can be received chunk by chunk (on_msg_chunk)
+ *  with bounded memory, while small msgs still work on the same connection.
+ * Add read-some mode to unpackers (i_unpacker::read_some), tcp::socket_base will use async_read_some and call parse_msg after every read.
+ * prefix_suffix_unpacker resumes the scanning of the suffix from where it stopped, and prefix_suffix_unpacker::memmem uses SIMD (SSE2 / AVX2) if available.
+ * Add batch_fixed_length_unpacker, it gets as many fixed length msgs as arrived in one read, and reads big msgs directly into their own buffers.
+ * Add hybrid_unpacker, it parses small msgs from a staging buffer (see macro ASCS_STAGING_BUFFER_SIZE) and reads big msgs directly into their own buffers.
+ * Add slab_unpacker and slab_msg, msgs share a reference-counted slab (the receive buffer) rather than being copied out of it.
+ * Demonstrate how fast lock_queue, non_lock_queue, mpsc_queue and spsc_queue are (with list and recycling_list) in new demo queue_test.
+ * Demonstrate how fast prefix_suffix_unpacker finds suffixes (compared with the old implementation) and how fast slab_unpacker parses msgs
+ *  (with the slab reused or reallocated, compared with unpacker) in new demo unpacker_test, which also checks how chunked_unpacker, batch_fixed_length_unpacker and hybrid_unpacker parse msgs.
+ *
+ * DELETION:
+ * Drop macro ASCS_MSG_RESUMING_INTERVAL, timer TIMER_CHECK_RECV and ascs::socket::msg_resuming_interval.
+ *
+ * REFACTORING:
+ *
+ * REPLACEMENTS:
+ *
  */
 
 #ifndef _ASCS_CONFIG_H_
@@ -604,8 +661,8 @@
 # pragma once
 #endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
 
-#define ASCS_VER		10403	//[x]xyyzz -> [x]x.[y]y.[z]z
-#define ASCS_VERSION	"1.4.3"
+#define ASCS_VER		10404	//[x]xyyzz -> [x]x.[y]y.[z]z
+#define ASCS_VERSION	"1.4.4"
 
 //asio and compiler check
 #ifdef _MSC_VER
@@ -668,12 +725,90 @@ static_assert(ASCS_SERVER_PORT > 0, "server port must be bigger than zero.");
 #endif
 static_assert(ASCS_MAX_SEND_BUF > 15, "send buffer capacity must be bigger than 15.");
 
+//ASCS_MAX_SEND_BUF is the high watermark of the send buffer, once the send buffer has been found unavailable (see ascs::socket::is_send_buffer_available),
+//ascs::socket::on_send_buffer_writable will be invoked and waiters in safe_send_(native_)msg will be woken up as soon as the send buffer drained
+//below this low watermark (bytes). this value can be changed via ascs::socket::send_buffer_low_watermark(size_t) at runtime.
+#ifndef ASCS_SEND_BUF_LOW_WATERMARK
+#define ASCS_SEND_BUF_LOW_WATERMARK	(ASCS_MAX_SEND_BUF / 2)
+#endif
+static_assert(ASCS_SEND_BUF_LOW_WATERMARK > 0 && ASCS_SEND_BUF_LOW_WATERMARK <= ASCS_MAX_SEND_BUF, "send buffer low watermark must be in range (0, ASCS_MAX_SEND_BUF].");
+
 //recv buffer's maximum size (bytes), it will be expanded dynamically (not fixed) within this range.
 #ifndef ASCS_MAX_RECV_BUF
 #define ASCS_MAX_RECV_BUF		1048576 //1M
 #endif
 static_assert(ASCS_MAX_RECV_BUF > 15, "recv buffer capacity must be bigger than 15.");
 
+//ASCS_MAX_RECV_BUF is the high watermark of the recv buffer, once the recv buffer overflowed, message receiving will be suspended,
+//and be resumed (by message dispatching or ascs::socket::pop_first/all_pending_recv_msg) as soon as the recv buffer drained
+//below this low watermark (bytes). this value can be changed via ascs::socket::recv_buffer_low_watermark(size_t) at runtime.
+#ifndef ASCS_RECV_BUF_LOW_WATERMARK
+#define ASCS_RECV_BUF_LOW_WATERMARK	(ASCS_MAX_RECV_BUF / 2)
+#endif
+static_assert(ASCS_RECV_BUF_LOW_WATERMARK > 0 && ASCS_RECV_BUF_LOW_WATERMARK <= ASCS_MAX_RECV_BUF, "recv buffer low watermark must be in range (0, ASCS_MAX_RECV_BUF].");
+
+//#define ASCS_SEND_BUF_BUDGET	268435456 //256M
+//#define ASCS_RECV_BUF_BUDGET	268435456 //256M
+//process-wide budgets (bytes) of all send buffers and all recv buffers, undefined (no budget) by default.
+//ASCS_MAX_SEND_BUF and ASCS_MAX_RECV_BUF limit each socket, so with a huge number of sockets, the worst case memory usage is terrible,
+//with these budgets, you can raise ASCS_MAX_SEND_BUF and ASCS_MAX_RECV_BUF to let a few busy sockets use large buffers while the total memory stays bounded.
+//once the budget been exhausted, is_send_buffer_available / is_recv_buffer_available will return false, unless the send / recv buffer is empty,
+//so the budget can be exceeded by at most one batch of messages per socket, this is to avoid starving sockets (they must be able to send and receive).
+//current usage can be fetched via ascs::send_buffer_budget().usage() and ascs::recv_buffer_budget().usage(), and the budgets can be changed
+//via ascs::send_buffer_budget().capacity(size_t) and ascs::recv_buffer_budget().capacity(size_t) at runtime.
+#ifdef ASCS_SEND_BUF_BUDGET
+static_assert(ASCS_SEND_BUF_BUDGET > 0, "send buffer budget must be bigger than zero.");
+#endif
+#ifdef ASCS_RECV_BUF_BUDGET
+static_assert(ASCS_RECV_BUF_BUDGET > 0, "recv buffer budget must be bigger than zero.");
+#endif
+
+//tcp only, when sending a batch of messages, messages smaller than this threshold (bytes) will be copied into a contiguous per-socket buffer,
+//bigger messages will still be sent by reference, this can significantly reduce the number of buffers passed to async_write (then writev)
+//if a huge number of small messages are sent. 0 means disable coalescing. it costs one more memory replication for small messages.
+//this value can be changed via ascs::tcp::socket_base::coalescing_threshold(size_t) at runtime.
+#ifndef ASCS_SEND_COALESCING_THRESHOLD
+#define ASCS_SEND_COALESCING_THRESHOLD	0
+#endif
+
+//tcp only, send corking, when a socket is idle (not sending), it will wait at most ASCS_CORK_DELAY microseconds or until the send buffer
+//reached ASCS_CORK_THRESHOLD bytes before sending, so bursts of messages can be sent in fewer async_write (and syscalls).
+//this trades a bounded latency for throughput, 0 means disable corking (send immediately, the default behavior).
+//these values can be changed via ascs::tcp::socket_base::cork_delay(unsigned) and cork_threshold(size_t) at runtime.
+#ifndef ASCS_CORK_DELAY
+#define ASCS_CORK_DELAY		0 //microseconds
+#endif
+static_assert(ASCS_CORK_DELAY >= 0, "cork delay must be bigger than or equal to zero.");
+
+#ifndef ASCS_CORK_THRESHOLD
+#define ASCS_CORK_THRESHOLD	65536 //asio sends at most 64K bytes per async_write in tcp::socket_base, bigger value is meaningless.
+#endif
+static_assert(ASCS_CORK_THRESHOLD > 0, "cork threshold must be bigger than zero.");
+
+//if defined, ascs::file_region (a region of a file) can be sent via direct_send_msg in tcp::socket_base, for plain tcp sockets on linux,
+//it will be transmitted by sendfile(2) without copying into the user space, otherwise (ssl for example), it will be read and sent chunk by chunk.
+//only messages which hold i_buffer (auto_buffer<i_buffer> or shared_buffer<i_buffer>, see packer2) can carry file regions.
+//#define ASCS_FILE_REGION
+
+//tcp only (ssl excluded), linux (4.14 or higher) only, messages not smaller than ASCS_ZEROCOPY_THRESHOLD bytes will be sent with MSG_ZEROCOPY,
+//they will be kept (pinned) after been sent until the kernel notifies their completions via the error queue, and only then on_msg_send
+//(or on_msgs_send) will be invoked for them. statistic::zerocopy_copied_sum tells how many times the kernel fell back to copying
+//(always for loopback). zero copy only pays for big messages (generally tens of kilobytes), so don't set it too small.
+//it can be changed per-socket at runtime via tcp::socket_base::zerocopy_threshold(size_t), 0 means disable zero copy.
+//#define ASCS_ZEROCOPY_THRESHOLD	65536
+#ifdef ASCS_ZEROCOPY_THRESHOLD
+	#if !defined(__linux__) || ASIO_VERSION < 101100
+		#ifdef _MSC_VER
+			#pragma message("MSG_ZEROCOPY is only available on linux with asio 1.11.0 or higher, macro ASCS_ZEROCOPY_THRESHOLD will be ignored.")
+		#else
+			#warning MSG_ZEROCOPY is only available on linux with asio 1.11.0 or higher, macro ASCS_ZEROCOPY_THRESHOLD will be ignored.
+		#endif
+		#undef ASCS_ZEROCOPY_THRESHOLD
+	#else
+		static_assert(ASCS_ZEROCOPY_THRESHOLD > 0, "zero copy threshold must be bigger than zero.");
+	#endif
+#endif
+
 //buffer (on stack) size used when writing logs.
 #ifndef ASCS_UNIFIED_OUT_BUF_NUM
 #define ASCS_UNIFIED_OUT_BUF_NUM	2048
@@ -705,11 +840,25 @@ static_assert(ASCS_DELAY_CLOSE >= 0, "delay close duration must be bigger than o
 //#define ASCS_FULL_STATISTIC
 
 //after every msg sent, call ascs::socket::on_msg_send()
+//for tcp, this makes each async_write carry only one message, which hurts throughput, see ASCS_WANT_BATCH_MSG_SEND_NOTIFY.
 //#define ASCS_WANT_MSG_SEND_NOTIFY
 
+//tcp only, keep sending multiple msgs in one async_write, and after it finished, call ascs::tcp::socket_base::on_msgs_send() with all these msgs,
+//if ASCS_WANT_MSG_SEND_NOTIFY also been defined, on_msg_send() will be invoked for each msg by the default implementation of on_msgs_send().
+//#define ASCS_WANT_BATCH_MSG_SEND_NOTIFY
+
 //after sending buffer became empty, call ascs::socket::on_all_msg_send()
 //#define ASCS_WANT_ALL_MSG_SEND_NOTIFY
 
+//if defined, messages which stayed in the send buffer for ASCS_MSG_TTL milliseconds or longer will not be sent but dropped, and
+//ascs::socket::on_msg_expired() will be invoked for each of them, they are counted in statistic::expired_msg_sum.
+//the ttl can be changed per-socket at runtime via ascs::socket::msg_ttl(unsigned), 0 means never expire.
+//this feature costs one more time point in each message (including received messages) and one system call per sending.
+//#define ASCS_MSG_TTL	0 //milliseconds
+#ifdef ASCS_MSG_TTL
+static_assert(ASCS_MSG_TTL >= 0, "message ttl must be bigger than or equal to zero.");
+#endif
+
 //max number of objects object_pool can hold.
 #ifndef ASCS_MAX_OBJECT_NUM
 #define ASCS_MAX_OBJECT_NUM	4096
@@ -824,6 +973,31 @@ static_assert(ASCS_ASYNC_ACCEPT_NUM > 0, "async accept number must be bigger tha
 #ifndef ASCS_OUTPUT_CONTAINER
 #define ASCS_OUTPUT_CONTAINER list
 #endif
+//mpsc_queue (lock-free for producers) is also available, it's designed for the send buffer which is fed by many threads but only consumed in rw_strand.
+//spsc_queue (lock-free ring buffer) is also available, it's designed for the receive buffer which is fed in rw_strand and consumed in dis_strand,
+//do not use it as the send buffer unless you send messages in only one thread (and never call pop_first/all_pending_send_msg concurrently).
+//capacity of spsc_queue (how many messages can be held in the ring buffer, not bytes), please note that it's allocated on each socket's construction,
+//if more messages are received, they will be spilled into a mutex protected container (no message will be lost).
+#ifndef ASCS_SPSC_QUEUE_CAPACITY
+#define ASCS_SPSC_QUEUE_CAPACITY	1024
+#endif
+static_assert(ASCS_SPSC_QUEUE_CAPACITY > 0, "spsc_queue's capacity must be bigger than zero.");
+
+//how many priority lanes the send buffer has, if it's bigger than 1, the send buffer will be a lane_queue of ASCS_INPUT_QUEUE,
+//messages in higher lanes will always be sent first, lane 0 is the default lane and heartbeat goes to the highest lane, so control messages
+//will not wait for bulk data (except those being sent). see ascs::socket::direct_send_priority_msg and ascs::tcp::socket_base::send_priority_msg.
+#ifndef ASCS_SEND_LANE_NUM
+#define ASCS_SEND_LANE_NUM	1
+#endif
+static_assert(ASCS_SEND_LANE_NUM > 0, "the number of send lanes must be bigger than zero.");
+
+//recycling_list (std::list with recycling_allocator) is also available for ASCS_INPUT_CONTAINER and ASCS_OUTPUT_CONTAINER, it recycles list nodes via
+//free lists of each thread, so no memory allocation will happen for list nodes in steady state (memory of messages themselves is not included),
+//this macro defines how many nodes can be held in each free list (each thread and each node type has its own free list).
+#ifndef ASCS_MAX_RECYCLED_NODE_NUM
+#define ASCS_MAX_RECYCLED_NODE_NUM	4096
+#endif
+
 //we also can control the queues (and their containers) via template parameters on class 'client_socket_base'
 //'server_socket_base', 'ssl::client_socket_base' and 'ssl::server_socket_base'.
 //we even can let a socket to use different queue (and / or different container) for input and output via template parameters.
@@ -864,14 +1038,13 @@ static_assert(ASCS_HEARTBEAT_MAX_ABSENCE > 0, "heartbeat absence must be bigger
 //#define ASCS_DECREASE_THREAD_AT_RUNTIME
 //enable decreasing service thread at runtime.
 
-#ifndef ASCS_MSG_RESUMING_INTERVAL
-#define ASCS_MSG_RESUMING_INTERVAL	50 //milliseconds
+#ifdef ASCS_MSG_RESUMING_INTERVAL
+	#ifdef _MSC_VER
+		#pragma message("macro ASCS_MSG_RESUMING_INTERVAL is useless, message receiving will be resumed as soon as the recv buffer drained below ASCS_RECV_BUF_LOW_WATERMARK.")
+	#else
+		#warning macro ASCS_MSG_RESUMING_INTERVAL is useless, message receiving will be resumed as soon as the recv buffer drained below ASCS_RECV_BUF_LOW_WATERMARK.
+	#endif
 #endif
-static_assert(ASCS_MSG_RESUMING_INTERVAL >= 0, "the interval of msg resuming must be bigger than or equal to zero.");
-//msg receiving
-//if receiving buffer is overflow, message receiving will stop and resume after the buffer becomes available, 
-//this is the interval of receiving buffer checking.
-//this value can be changed via ascs::socket::msg_resuming_interval(size_t) at runtime.
 
 #ifndef ASCS_MSG_HANDLING_INTERVAL
 #define ASCS_MSG_HANDLING_INTERVAL	50 //milliseconds
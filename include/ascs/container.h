@@ -184,10 +184,713 @@ private:
 	size_t total_size;
 };
 
+//an allocator which recycles single object blocks (list nodes for example) via a free list of the current thread instead of freeing them,
+//so in steady state, containers which use this allocator will not call operator new and delete for every element.
+//a block can be freed in another thread than the one which allocated it (for example, the send buffer), then it goes to the free list
+//of the freeing thread, each free list holds at most ASCS_MAX_RECYCLED_NODE_NUM blocks, extra blocks will be freed.
+//the free list belongs to the thread, not the allocator, so all allocators are equal, then splice between containers is still O(1).
+template<typename T>
+class recycling_allocator : public std::allocator<T>
+{
+public:
+	template<typename U> struct rebind {typedef recycling_allocator<U> other;};
+
+	recycling_allocator() {}
+	recycling_allocator(const recycling_allocator& other) : std::allocator<T>(other) {}
+	template<typename U> recycling_allocator(const recycling_allocator<U>& other) : std::allocator<T>(other) {}
+
+	//only instantiated for the types which are really allocated (list nodes after rebinding), not the value type of the container.
+	T* allocate(size_t n)
+	{
+		static_assert(sizeof(T) >= sizeof(free_block), "recycling_allocator cannot hold objects smaller than a pointer.");
+#if !defined(_MSC_VER) || _MSC_VER > 1800 //thread_local is not supported by VC++ 12.0
+		if (1 == n)
+		{
+			auto& list = get_free_list();
+			if (nullptr != list.head)
+			{
+				auto p = list.head;
+				list.head = p->next;
+				--list.num;
+				return (T*) p;
+			}
+		}
+#endif
+		return std::allocator<T>::allocate(n);
+	}
+
+	void deallocate(T* p, size_t n)
+	{
+		static_assert(sizeof(T) >= sizeof(free_block), "recycling_allocator cannot hold objects smaller than a pointer.");
+#if !defined(_MSC_VER) || _MSC_VER > 1800
+		if (1 == n)
+		{
+			auto& list = get_free_list();
+			if (list.num < ASCS_MAX_RECYCLED_NODE_NUM)
+			{
+				auto block = (free_block*) p;
+				block->next = list.head;
+				list.head = block;
+				++list.num;
+				return;
+			}
+		}
+#endif
+		std::allocator<T>::deallocate(p, n);
+	}
+
+protected:
+	struct free_block {free_block* next;};
+
+	struct free_list
+	{
+		free_list() : head(nullptr), num(0) {}
+		~free_list() {while (nullptr != head) {auto p = head; head = head->next; std::allocator<T>().deallocate((T*) p, 1);}}
+
+		free_block* head;
+		size_t num;
+	};
+
+#if !defined(_MSC_VER) || _MSC_VER > 1800
+	static free_list& get_free_list() {static thread_local free_list list; return list;}
+#endif
+};
+
+template<typename T, typename U> bool operator==(const recycling_allocator<T>&, const recycling_allocator<U>&) {return true;}
+template<typename T, typename U> bool operator!=(const recycling_allocator<T>&, const recycling_allocator<U>&) {return false;}
+
+//a std::list which recycles its nodes, use it as ASCS_INPUT_CONTAINER and / or ASCS_OUTPUT_CONTAINER.
+template<typename T> using recycling_list = std::list<T, recycling_allocator<T>>;
+
 //ascs requires that queue must take one and only one template argument
 template<typename Container> using non_lock_queue = queue<Container, dummy_lockable>; //thread safety depends on Container
 template<typename Container> using lock_queue = queue<Container, lockable>;
 
+//multiple producers and single consumer queue, enqueue and move_items_in are lock-free (one atomic exchange for each invocation),
+//all other functions are consumer functions, they're serialized by a mutex, so they're still thread safe, but please note that they will
+//compete with each other (for example, pop_first_pending_send_msg will compete with do_send_msg), so it's suitable for the send buffer,
+//because messages are pushed from many threads, but only consumed in rw_strand.
+//elements are held in a linked list of atomic nodes, Container is just used to move elements in and out, so any container which can be
+//used with lock_queue can also be used with mpsc_queue.
+template<typename Container>
+class mpsc_queue
+{
+public:
+	typedef typename Container::value_type value_type;
+	typedef typename Container::size_type size_type;
+	typedef typename Container::reference reference;
+	typedef typename Container::const_reference const_reference;
+
+protected:
+	struct node
+	{
+		node() : next(nullptr) {}
+		template<typename T> node(T&& item) : next(nullptr), value(std::forward<T>(item)) {}
+
+		std::atomic<node*> next;
+		value_type value;
+	};
+
+public:
+	mpsc_queue() : head(new node), tail(head.load()), item_num(0), total_size(0) {}
+	mpsc_queue(size_t) : mpsc_queue() {}
+	~mpsc_queue() {clear(); delete tail;}
+
+	//thread safe
+	bool is_thread_safe() const {return true;}
+	bool empty() const {return 0 == item_num;} //may return false while the last enqueued message is not visible to the consumer yet
+	size_t size_in_byte() const {return total_size;}
+	void clear() {lockable::lock_guard lock(consumer_mutex); Container can; move_items_out_(can, -1);}
+	void swap(Container& can)
+	{
+		lockable::lock_guard lock(consumer_mutex);
+		Container tmp_can;
+		move_items_out_(tmp_can, -1);
+		move_items_in(can);
+		can.swap(tmp_can);
+	}
+
+	template<typename T> bool enqueue(T&& item)
+	{
+		node* new_node = nullptr;
+		try {new_node = new node(std::forward<T>(item));}
+		catch (const std::exception& e)
+		{
+			unified_out::error_out("cannot hold more objects (%s)", e.what());
+			return false;
+		}
+
+		link(new_node, new_node, 1, new_node->value.size());
+		return true;
+	}
+
+	void move_items_in(Container& src, size_t size_in_byte = 0)
+	{
+		if (src.empty())
+			return;
+
+		node* first = nullptr, * last = nullptr;
+		size_t num = 0, size = 0;
+		try
+		{
+			for (auto& item : src)
+			{
+				auto new_node = new node(std::move(item));
+				if (nullptr == last)
+					first = new_node;
+				else
+					last->next.store(new_node, std::memory_order_relaxed);
+				last = new_node;
+
+				++num;
+				size += new_node->value.size();
+			}
+		}
+		catch (const std::exception& e)
+		{
+			unified_out::error_out("cannot hold more objects (%s)", e.what());
+			while (nullptr != first)
+			{
+				auto next = first->next.load(std::memory_order_relaxed);
+				delete first;
+				first = next;
+			}
+			src.clear();
+			return;
+		}
+
+		assert(0 == size_in_byte || size == size_in_byte);
+		src.clear();
+		link(first, last, num, size);
+	}
+
+	bool try_dequeue(reference item)
+	{
+		lockable::lock_guard lock(consumer_mutex);
+		auto first = pop_();
+		if (nullptr == first)
+			return false;
+
+		item.swap(first->value);
+		sub(1, item.size());
+		return true;
+	}
+
+	void move_items_out(Container& dest, size_t max_item_num = -1) {lockable::lock_guard lock(consumer_mutex); move_items_out_(dest, max_item_num);}
+	void move_items_out(size_t max_size_in_byte, Container& dest)
+	{
+		lockable::lock_guard lock(consumer_mutex);
+		size_t num = 0, size = 0;
+		for (auto first = pop_(); nullptr != first; first = pop_())
+		{
+			++num;
+			size += first->value.size();
+			dest.emplace_back(std::move(first->value));
+			first->value.clear();
+			if (size >= max_size_in_byte)
+				break;
+		}
+		sub(num, size);
+	}
+
+	template<typename _Predicate> void do_something_to_all(const _Predicate& __pred)
+		{lockable::lock_guard lock(consumer_mutex); for (auto iter = first_(); nullptr != iter; iter = iter->next.load(std::memory_order_acquire)) __pred(iter->value);}
+	template<typename _Predicate> void do_something_to_one(const _Predicate& __pred)
+		{lockable::lock_guard lock(consumer_mutex); for (auto iter = first_(); nullptr != iter; iter = iter->next.load(std::memory_order_acquire)) if (__pred(iter->value)) break;}
+	//thread safe
+
+protected:
+	//producers, counters are increased before the new node(s) become visible, so they never underflow
+	void link(node* first, node* last, size_t num, size_t size)
+	{
+		item_num += num;
+		total_size += size;
+		head.exchange(last, std::memory_order_acq_rel)->next.store(first, std::memory_order_release);
+	}
+
+	//consumer, the returned node becomes the new dummy node, its value must be consumed by the caller
+	node* first_() const {return tail->next.load(std::memory_order_acquire);}
+	node* pop_() {auto first = first_(); if (nullptr != first) {delete tail; tail = first;} return first;}
+	void sub(size_t num, size_t size) {item_num -= num; total_size -= size;}
+
+	void move_items_out_(Container& dest, size_t max_item_num)
+	{
+		size_t num = 0, size = 0;
+		while (num < max_item_num)
+		{
+			auto first = pop_();
+			if (nullptr == first)
+				break;
+
+			++num;
+			size += first->value.size();
+			dest.emplace_back(std::move(first->value));
+			first->value.clear();
+		}
+		sub(num, size);
+	}
+
+private:
+	mpsc_queue(const mpsc_queue&) = delete;
+	mpsc_queue& operator=(const mpsc_queue&) = delete;
+
+private:
+	std::atomic<node*> head; //producers
+	char padding[64]; //keep producers and the consumer away from the same cache line
+	node* tail; //consumer
+	lockable consumer_mutex;
+
+	std::atomic_size_t item_num, total_size;
+};
+
+//single producer and single consumer queue, based on a bounded ring buffer (capacity is the number of messages, not bytes),
+//enqueue and move_items_in are producer functions, all other functions (except empty and size_in_byte) are consumer functions,
+//producer functions and consumer functions can be invoked concurrently, but producer functions cannot be invoked concurrently with each other,
+//so do consumer functions. this is exactly the case of the receive buffer: messages are pushed in rw_strand and consumed in dis_strand.
+//if the ring buffer is full (ASCS_MAX_RECV_BUF limits bytes, not messages), the producer will spill messages to a mutex protected Container,
+//until the consumer fetches them, so no message will be lost and the sequence of messages will be kept, but please use a big enough capacity,
+//spilling is the slow path.
+template<typename Container>
+class spsc_queue
+{
+public:
+	typedef typename Container::value_type value_type;
+	typedef typename Container::size_type size_type;
+	typedef typename Container::reference reference;
+	typedef typename Container::const_reference const_reference;
+
+	spsc_queue() : spsc_queue(ASCS_SPSC_QUEUE_CAPACITY) {}
+	spsc_queue(size_t capacity) : buffer(capacity + 1), head(0), tail(0), spilled(false), item_num(0), total_size(0) {}
+
+	//thread safe
+	bool is_thread_safe() const {return true;}
+	bool empty() const {return 0 == item_num;}
+	size_t size_in_byte() const {return total_size;}
+	void clear() {Container can; move_items_out(can);}
+	void swap(Container& can)
+	{
+		auto size_in_byte = ascs::get_size_in_byte(can);
+		size_t num = 0;
+		for (auto iter = std::begin(can); iter != std::end(can); ++iter)
+			++num;
+
+		Container tmp_can;
+		move_items_out(tmp_can);
+
+		//the consumer owns fetched_can, and it will be consumed before the ring buffer, so the sequence is kept
+		fetched_can.splice(std::end(fetched_can), can);
+		item_num += num;
+		total_size += size_in_byte;
+		can.swap(tmp_can);
+	}
+
+	//producer
+	template<typename T> bool enqueue(T&& item)
+	{
+		auto size = item.size();
+		++item_num;
+		total_size += size;
+
+		if (!spilled)
+		{
+			auto pos = tail.load(std::memory_order_relaxed), next = inc(pos);
+			if (next != head.load(std::memory_order_acquire))
+			{
+				buffer[pos] = std::forward<T>(item);
+				tail.store(next, std::memory_order_release);
+				return true;
+			}
+		}
+
+		try
+		{
+			lockable::lock_guard lock(spill_mutex);
+			spilled_can.emplace_back(std::forward<T>(item));
+			spilled = true;
+		}
+		catch (const std::exception& e)
+		{
+			unified_out::error_out("cannot hold more objects (%s)", e.what());
+			--item_num;
+			total_size -= size;
+			return false;
+		}
+
+		return true;
+	}
+
+	void move_items_in(Container& src, size_t size_in_byte = 0)
+	{
+		if (0 == size_in_byte)
+			size_in_byte = ascs::get_size_in_byte(src);
+		else
+			assert(ascs::get_size_in_byte(src) == size_in_byte);
+
+		size_t num = 0;
+		for (auto iter = std::begin(src); iter != std::end(src); ++iter)
+			++num;
+
+		item_num += num;
+		total_size += size_in_byte;
+
+		if (!spilled)
+		{
+			auto pos = tail.load(std::memory_order_relaxed), end = head.load(std::memory_order_acquire);
+			for (auto next = inc(pos); !src.empty() && next != end; pos = next, next = inc(pos))
+			{
+				buffer[pos] = std::move(src.front());
+				src.pop_front();
+			}
+			tail.store(pos, std::memory_order_release);
+		}
+
+		if (!src.empty())
+		{
+			lockable::lock_guard lock(spill_mutex);
+			spilled_can.splice(std::end(spilled_can), src);
+			spilled = true;
+		}
+	}
+	//producer
+
+	//consumer
+	bool try_dequeue(reference item)
+	{
+		if (!pop_one([&item](reference msg) {item.swap(msg);}))
+			return false;
+
+		--item_num;
+		total_size -= item.size();
+		return true;
+	}
+
+	void move_items_out(Container& dest, size_t max_item_num = -1)
+	{
+		size_t num = 0, size = 0;
+		for (; num < max_item_num && pop_one([&](reference msg) {size += msg.size(); dest.emplace_back(std::move(msg));}); ++num);
+
+		item_num -= num;
+		total_size -= size;
+	}
+
+	void move_items_out(size_t max_size_in_byte, Container& dest)
+	{
+		size_t num = 0, size = 0;
+		while (pop_one([&](reference msg) {size += msg.size(); dest.emplace_back(std::move(msg));}))
+		{
+			++num;
+			if (size >= max_size_in_byte)
+				break;
+		}
+
+		item_num -= num;
+		total_size -= size;
+	}
+
+	template<typename _Predicate> void do_something_to_all(const _Predicate& __pred)
+	{
+		for (auto& item : fetched_can)
+			__pred(item);
+		for (auto pos = head.load(std::memory_order_relaxed), end = tail.load(std::memory_order_acquire); pos != end; pos = inc(pos))
+			__pred(buffer[pos]);
+
+		lockable::lock_guard lock(spill_mutex);
+		for (auto& item : spilled_can)
+			__pred(item);
+	}
+
+	template<typename _Predicate> void do_something_to_one(const _Predicate& __pred)
+	{
+		for (auto& item : fetched_can)
+			if (__pred(item))
+				return;
+		for (auto pos = head.load(std::memory_order_relaxed), end = tail.load(std::memory_order_acquire); pos != end; pos = inc(pos))
+			if (__pred(buffer[pos]))
+				return;
+
+		lockable::lock_guard lock(spill_mutex);
+		for (auto& item : spilled_can)
+			if (__pred(item))
+				return;
+	}
+	//consumer
+	//thread safe
+
+protected:
+	size_t inc(size_t pos) const {return ++pos == buffer.size() ? 0 : pos;}
+
+	//hand the first message to __pred, sequence: fetched_can -> ring buffer -> spilled_can
+	template<typename _Predicate> bool pop_one(const _Predicate& __pred)
+	{
+		if (fetched_can.empty())
+		{
+			auto pos = head.load(std::memory_order_relaxed);
+			if (pos != tail.load(std::memory_order_acquire))
+			{
+				__pred(buffer[pos]);
+				buffer[pos] = value_type(); //release memory as soon as possible
+				head.store(inc(pos), std::memory_order_release);
+				return true;
+			}
+			else if (!spilled)
+				return false;
+
+			//the ring buffer is empty, and the producer will not use it until spilled is reset
+			lockable::lock_guard lock(spill_mutex);
+			fetched_can.splice(std::end(fetched_can), spilled_can);
+			spilled = false;
+			if (fetched_can.empty())
+				return false;
+		}
+
+		__pred(fetched_can.front());
+		fetched_can.pop_front();
+		return true;
+	}
+
+private:
+	spsc_queue(const spsc_queue&) = delete;
+	spsc_queue& operator=(const spsc_queue&) = delete;
+
+private:
+	std::vector<value_type> buffer;
+	std::atomic_size_t head; //consumer
+	char padding[64]; //keep the producer and the consumer away from the same cache line
+	std::atomic_size_t tail; //producer
+
+	Container fetched_can; //consumer
+	Container spilled_can;
+	lockable spill_mutex;
+	std::atomic_bool spilled;
+
+	std::atomic_size_t item_num, total_size;
+};
+
+//a queue with LaneNum lanes (each lane is a Queue<Container>), lane 0 is the default lane and lane LaneNum - 1 has the highest priority,
+//items are always consumed from higher lanes first, and byte accounting is unified (size_in_byte returns the total size of all lanes).
+//a message may consist of several items (pieces), all pieces but the last one have member more_pieces been set (see obj_with_begin_time),
+//lanes will only be switched at message boundaries, so pieces of one message will always be consumed contiguously.
+//it's used as the send buffer if ASCS_SEND_LANE_NUM is bigger than 1, thread safety depends on Queue (consumer functions must not be invoked concurrently).
+template<template<typename> class Queue, typename Container, size_t LaneNum>
+class lane_queue
+{
+public:
+	typedef typename Container::value_type value_type;
+	typedef typename Container::size_type size_type;
+	typedef typename Container::reference reference;
+	typedef typename Container::const_reference const_reference;
+
+	static_assert(LaneNum > 0, "lane_queue needs at least one lane.");
+
+	lane_queue() : unfinished_lane(LaneNum) {}
+	lane_queue(size_t) : lane_queue() {}
+
+	bool is_thread_safe() const {return lanes[0].is_thread_safe();}
+	bool empty() const {for (auto& lane : lanes) if (!lane.empty()) return false; return true;}
+	size_t size_in_byte() const {size_t size = 0; for (auto& lane : lanes) size += lane.size_in_byte(); return size;}
+	void clear() {for (auto& lane : lanes) lane.clear(); unfinished_lane = LaneNum;}
+	void swap(Container& can) {Container items; move_items_out(items); lanes[0].move_items_in(can); can.swap(items);}
+
+	//lane will be truncated to LaneNum - 1 if it's too big, all items in src will be consumed contiguously if they're pieces of one message.
+	template<typename T> bool enqueue(T&& item, size_t lane = 0) {return lanes[std::min(lane, LaneNum - 1)].enqueue(std::forward<T>(item));}
+	void move_items_in(Container& src, size_t size_in_byte = 0, size_t lane = 0) {lanes[std::min(lane, LaneNum - 1)].move_items_in(src, size_in_byte);}
+
+	bool try_dequeue(reference item)
+	{
+		if (LaneNum != unfinished_lane)
+			return try_dequeue(unfinished_lane, item);
+
+		for (auto i = LaneNum; i > 0; --i)
+			if (try_dequeue(i - 1, item))
+				return true;
+
+		return false;
+	}
+
+	void move_items_out(Container& dest, size_t max_item_num = -1)
+	{
+		if (LaneNum == unfinished_lane || move_items_out(unfinished_lane, dest, max_item_num))
+			for (auto i = LaneNum; i > 0; --i)
+				if (!move_items_out(i - 1, dest, max_item_num))
+					break;
+	}
+
+	//like other queues, at least one item will be moved out (if any), even if max_size_in_byte is zero.
+	void move_items_out(size_t max_size_in_byte, Container& dest)
+	{
+		if ((size_t) -1 == max_size_in_byte)
+			return move_items_out(dest);
+
+		size_t size = 0;
+		if (LaneNum == unfinished_lane || move_items_out(unfinished_lane, max_size_in_byte, size, dest))
+			for (auto i = LaneNum; i > 0; --i)
+				if (!move_items_out(i - 1, max_size_in_byte, size, dest))
+					break;
+	}
+
+	template<typename _Predicate> void do_something_to_all(const _Predicate& __pred) {for (auto i = LaneNum; i > 0; --i) lanes[i - 1].do_something_to_all(__pred);}
+	template<typename _Predicate> void do_something_to_one(const _Predicate& __pred)
+	{
+		auto found = false;
+		for (auto i = LaneNum; !found && i > 0; --i)
+			lanes[i - 1].do_something_to_one([&](reference item) {return (found = __pred(item));});
+	}
+
+private:
+	bool try_dequeue(size_t lane, reference item)
+	{
+		if (!lanes[lane].try_dequeue(item))
+			return false;
+
+		unfinished_lane = item.more_pieces ? lane : LaneNum;
+		return true;
+	}
+
+	//return false if no more items should be moved out (the limitation reached or a message is unfinished)
+	bool move_items_out(size_t lane, Container& dest, size_t& max_item_num)
+	{
+		if (0 == max_item_num)
+			return false;
+		else if (lanes[lane].empty())
+			return true;
+
+		Container items; //Container's size() may have linear complexity, so count items moved out of this lane only
+		lanes[lane].move_items_out(items, max_item_num);
+		if (items.empty())
+			return true;
+		else if ((size_t) -1 != max_item_num)
+			for (auto iter = std::begin(items); iter != std::end(items); ++iter)
+				--max_item_num;
+
+		unfinished_lane = items.back().more_pieces ? lane : LaneNum;
+		dest.splice(std::end(dest), items);
+		return LaneNum == unfinished_lane && max_item_num > 0;
+	}
+
+	bool move_items_out(size_t lane, size_t max_size_in_byte, size_t& size, Container& dest)
+	{
+		if (lanes[lane].empty())
+			return true;
+
+		Container items;
+		lanes[lane].move_items_out(max_size_in_byte - size, items);
+		if (items.empty())
+			return true;
+
+		size += ascs::get_size_in_byte(items);
+		unfinished_lane = items.back().more_pieces ? lane : LaneNum;
+		dest.splice(std::end(dest), items);
+		return LaneNum == unfinished_lane && size < max_size_in_byte;
+	}
+
+private:
+	Queue<Container> lanes[LaneNum];
+	size_t unfinished_lane; //the lane in which a message has been partially consumed, LaneNum means none, consumer only
+};
+
+//msgs which have been sent with MSG_ZEROCOPY (see tcp::socket_base), the kernel may still read them, so they must stay untouched until
+//the kernel releases them. each successful zero copy send consumes one notification id (32 bits, wraps around), so a msg which has been sent
+//via several sends occupies a contiguous range of ids, and it can only be released after all of them have completed.
+//the kernel reports completed ranges of ids, they can cover several msgs, a part of a msg, and can arrive out of order (after retransmission
+//for example), or even before the msg been pinned (msgs are pinned after the whole batch been sent), ids never complete twice. not thread safe.
+template<typename Container>
+class zerocopy_list
+{
+public:
+	bool empty() const {return ranges.empty();}
+	size_t size() const {return ranges.size();}
+	void clear() {msgs.clear(); ranges.clear(); early_ranges.clear();}
+	template<typename _Predicate> void do_something_to_all(const _Predicate& __pred) {ascs::do_something_to_all(msgs, __pred);}
+
+	//take over the msg which iter points to (in can), it has been sent with notification ids [first_id, last_id].
+	//msgs must be pinned in the sequence of sending, call release after pinning, some msgs may have completed already.
+	void pin(Container& can, typename Container::iterator iter, uint32_t first_id, uint32_t last_id)
+	{
+		msgs.splice(std::end(msgs), can, iter, std::next(iter));
+		ranges.emplace_back(first_id, last_id);
+		for (auto early = std::begin(early_ranges); early != std::end(early_ranges);)
+			if (before(last_id, early->first_id) || before(early->last_id, first_id)) //no overlapping
+				++early;
+			else
+			{
+				ranges.back().mark(early->first_id, early->last_id);
+				if (before(last_id, early->last_id)) //the rest belongs to msgs which have not been pinned yet
+					(early++)->first_id = last_id + 1;
+				else
+					early = early_ranges.erase(early);
+			}
+	}
+
+	//notification ids [first_id, last_id] have completed, then release msgs whose ids all have completed (see release).
+	template<typename Handler> size_t complete(uint32_t first_id, uint32_t last_id, const Handler& handler)
+	{
+		for (auto& range : ranges) //ranges are in the sequence of ids
+			if (before(last_id, range.first_id))
+				break;
+			else if (!before(range.last_id, first_id))
+				range.mark(first_id, last_id);
+
+		if (ranges.empty()) //ids belong to msgs which have not been pinned yet
+			early_ranges.emplace_back(first_id, last_id);
+		else if (before(ranges.back().last_id, last_id))
+			early_ranges.emplace_back(before(ranges.back().last_id, first_id) ? first_id : ranges.back().last_id + 1, last_id);
+
+		return release(handler);
+	}
+
+	//msgs whose ids all have completed will be moved out and passed to handler (only if any, in the sequence of sending) with a Container,
+	//return how many msgs have been released.
+	template<typename Handler> size_t release(const Handler& handler)
+	{
+		Container released;
+		size_t num = 0;
+		auto iter = std::begin(msgs);
+		for (auto range = std::begin(ranges); range != std::end(ranges);)
+			if (0 == range->remain)
+			{
+				auto next = std::next(iter);
+				released.splice(std::end(released), msgs, iter, next);
+				iter = next;
+				range = ranges.erase(range);
+				++num;
+			}
+			else
+			{
+				++iter;
+				++range;
+			}
+
+		if (num > 0)
+			handler(released);
+		return num;
+	}
+
+private:
+	static bool before(uint32_t id1, uint32_t id2) {return (int32_t) (id1 - id2) < 0;} //ids wrap around
+
+	struct id_range
+	{
+		id_range(uint32_t first_id_, uint32_t last_id_) : first_id(first_id_), last_id(last_id_), remain(last_id_ - first_id_ + 1) {}
+
+		//ids [first, last] (must overlap this range) have completed
+		void mark(uint32_t first, uint32_t last)
+		{
+			if (before(first, first_id))
+				first = first_id;
+			if (before(last_id, last))
+				last = last_id;
+			remain -= last - first + 1;
+		}
+
+		uint32_t first_id, last_id;
+		uint32_t remain; //how many ids have not completed
+	};
+
+	Container msgs;
+	std::list<id_range> ranges; //one for each msg in msgs, in the same sequence
+	std::list<id_range> early_ranges; //completed ids which belong to msgs that have not been pinned yet (remain is not used)
+};
+
 } //namespace
 
 #endif /* _ASCS_CONTAINER_H_ */
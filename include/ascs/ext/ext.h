@@ -13,6 +13,8 @@
 #ifndef _ASCS_EXT_H_
 #define _ASCS_EXT_H_
 
+#include <array>
+
 #include "../base.h"
 
 //the size of the buffer used when receiving msg, must equal to or larger than the biggest msg size,
@@ -29,6 +31,26 @@ static_assert(ASCS_MSG_BUFFER_SIZE > 0, "message buffer size must be bigger than
 //define this macro will introduce scatter-gather buffers when doing async read, it's very useful under certain situations (for example, ring buffer).
 //this macro is used by unpackers only, it doesn't belong to ascs.
 
+//#define ASCS_POOLED_RECV_BUFFER
+//define this macro to let unpacker, prefix_suffix_unpacker and stream_unpacker borrow their ASCS_MSG_BUFFER_SIZE bytes buffer from a process-wide
+//pool (see recv_buffer_pool()) only when they need it, which is, a half-baked msg is pending or the last read filled the whole buffer (more data
+//are probably waiting in the SOCKET), otherwise the buffer will be given back, and the next read will use a small stub buffer (ASCS_RECV_STUB_SIZE bytes).
+//so idle sockets only occupy ASCS_RECV_STUB_SIZE bytes rather than ASCS_MSG_BUFFER_SIZE bytes, this is useful if you have a lot of mostly-idle connections.
+//the cost is one more read (and a memory copy of at most ASCS_RECV_STUB_SIZE bytes) when a socket wakes up with a msg bigger than the stub buffer.
+//udp_unpacker doesn't support this, because an udp msg must be received entirely in one read.
+//this macro is used by unpackers only, it doesn't belong to ascs.
+#ifdef ASCS_POOLED_RECV_BUFFER
+	#ifndef ASCS_RECV_STUB_SIZE
+	#define ASCS_RECV_STUB_SIZE	64
+	#endif
+	static_assert(ASCS_RECV_STUB_SIZE > 0 && ASCS_RECV_STUB_SIZE < ASCS_MSG_BUFFER_SIZE, "recv stub size must be bigger than zero and less than ASCS_MSG_BUFFER_SIZE.");
+
+	//how many idle buffers the pool keeps, exceeded buffers will be freed when they are given back.
+	#ifndef ASCS_MAX_IDLE_RECV_BUFFER
+	#define ASCS_MAX_IDLE_RECV_BUFFER	256
+	#endif
+#endif
+
 #ifdef ASCS_HUGE_MSG
 #define ASCS_HEAD_TYPE	uint32_t
 #define ASCS_HEAD_H2N	htonl
@@ -40,6 +62,15 @@ static_assert(ASCS_MSG_BUFFER_SIZE > 0, "message buffer size must be bigger than
 #endif
 #define ASCS_HEAD_LEN	(sizeof(ASCS_HEAD_TYPE))
 
+//the size of the staging buffer used by hybrid_unpacker, msgs which can be held in it will be parsed from it (many msgs per read),
+//bigger msgs will be read directly into their own buffers (no memory replication, just like non_copy_unpacker).
+//the default value is 1024, or ASCS_MSG_BUFFER_SIZE if it's smaller.
+#ifndef ASCS_STAGING_BUFFER_SIZE
+#define ASCS_STAGING_BUFFER_SIZE	(ASCS_MSG_BUFFER_SIZE < 1024 ? ASCS_MSG_BUFFER_SIZE : 1024)
+#endif
+static_assert(ASCS_STAGING_BUFFER_SIZE > ASCS_HEAD_LEN && ASCS_STAGING_BUFFER_SIZE <= ASCS_MSG_BUFFER_SIZE,
+	"staging buffer size must be bigger than ASCS_HEAD_LEN and not bigger than ASCS_MSG_BUFFER_SIZE.");
+
 namespace ascs { namespace ext {
 
 //implement i_buffer interface, then string_buffer can be wrapped by auto_buffer or shared_buffer
@@ -51,6 +82,54 @@ public:
 	virtual const char* data() const {return std::string::data();}
 };
 
+//a reference-counted buffer shared by many slab_msg (see slab_unpacker), it's allocated together with its reference counter (one allocation).
+typedef std::array<char, ASCS_MSG_BUFFER_SIZE> slab_type;
+
+//a lightweight msg (pointer + length + slab reference), which shares the slab with other msgs (no memory replication),
+//the slab will be kept alive until all msgs in it have been destroyed (or cleared), so please don't hold these msgs for a long time,
+//otherwise, slab_unpacker cannot reuse the slab and must allocate a new one.
+class slab_msg
+{
+public:
+	slab_msg() : len(0) {}
+	slab_msg(const std::shared_ptr<slab_type>& slab, const char* data_, size_t len_) : buff(slab, data_), len(len_) {}
+
+	//the following five functions are needed by ascs
+	bool empty() const {return 0 == len;}
+	size_t size() const {return len;}
+	const char* data() const {return buff.get();}
+	void swap(slab_msg& other) {buff.swap(other.buff); std::swap(len, other.len);}
+	void clear() {buff.reset(); len = 0;}
+
+private:
+	std::shared_ptr<const char> buff; //points into the slab, and shares the ownership of the slab
+	size_t len;
+};
+
+//a msg, or a chunk of a big msg (bigger than ASCS_MSG_BUFFER_SIZE) which will be delivered chunk by chunk, used by chunked_unpacker.
+//for chunks, id identifies the big msg (unique in one socket), offset is the position of this chunk in the msg's body,
+//last means this is the last chunk of the msg; for normal msgs, id is zero (is_chunk() returns false).
+class msg_chunk : public std::string
+{
+public:
+	msg_chunk() : _id(0), _offset(0), _last(true) {}
+	msg_chunk(const char* data, size_t len) : std::string(data, len), _id(0), _offset(0), _last(true) {}
+	msg_chunk(uint_fast64_t id_, size_t offset_, const char* data, size_t len, bool last_) : std::string(data, len), _id(id_), _offset(offset_), _last(last_) {}
+
+	bool is_chunk() const {return 0 != _id;}
+	uint_fast64_t id() const {return _id;}
+	size_t offset() const {return _offset;}
+	bool last() const {return _last;}
+
+	void swap(msg_chunk& other) {std::string::swap(other); std::swap(_id, other._id); std::swap(_offset, other._offset); std::swap(_last, other._last);}
+	void clear() {std::string::clear(); _id = 0; _offset = 0; _last = true;}
+
+private:
+	uint_fast64_t _id;
+	size_t _offset;
+	bool _last;
+};
+
 class basic_buffer
 #if defined(_MSC_VER) && _MSC_VER <= 1800
 	: public asio::noncopyable
@@ -86,6 +165,127 @@ protected:
 	size_t len, buff_len;
 };
 
+//a message with an inline length header, so no memory allocation is needed for the header, the header and the body will be sent
+//as two buffers by tcp::socket_base (see append_buffers below), used by inline_header_packer (tcp only).
+//notice: data() and size() only describe the body, the header can only be got via head_data() and head_size(), and it will not be counted
+//in the send buffer's size, empty() returns false if the header exists (a heartbeat for example).
+class inline_header_msg
+{
+public:
+	inline_header_msg() : head(0), head_len(0) {}
+	inline_header_msg(std::string&& body_) : head(0), head_len(0), body(std::move(body_)) {}
+	inline_header_msg(const std::string& body_) : head(0), head_len(0), body(body_) {}
+
+	void set_head(ASCS_HEAD_TYPE head_) {head = head_; head_len = ASCS_HEAD_LEN;} //head_ must be in network byte order
+	void clear_head() {head_len = 0;}
+	const char* head_data() const {return (const char*) &head;}
+	size_t head_size() const {return head_len;}
+
+	std::string& str() {return body;}
+	const std::string& str() const {return body;}
+
+	//the following five functions are needed by ascs
+	bool empty() const {return 0 == head_len && body.empty();}
+	size_t size() const {return body.size();}
+	const char* data() const {return body.data();}
+	void swap(inline_header_msg& other) {std::swap(head, other.head); std::swap(head_len, other.head_len); body.swap(other.body);}
+	void clear() {head_len = 0; body.clear();}
+
+private:
+	ASCS_HEAD_TYPE head;
+	size_t head_len;
+	std::string body;
+};
+
+template<typename Buffers> inline void append_buffers(Buffers& buffers, const inline_header_msg& msg)
+{
+	if (msg.head_size() > 0)
+		buffers.emplace_back(msg.head_data(), msg.head_size());
+	if (msg.size() > 0)
+		buffers.emplace_back(msg.data(), msg.size());
+}
+
+#ifdef ASCS_POOLED_RECV_BUFFER
+//fixed size buffers shared by many unpackers, see macro ASCS_POOLED_RECV_BUFFER for more details.
+class buffer_pool : public asio::noncopyable
+{
+public:
+	buffer_pool(size_t buffer_size_, size_t max_idle_num_) : buffer_size(buffer_size_), max_idle_num(max_idle_num_), used_num(0) {}
+	~buffer_pool() {do_something_to_all(buffers, [](char* item) {delete[] item;});}
+
+	size_t idle_num() {std::lock_guard<std::mutex> lock(mutex); return buffers.size();}
+	size_t in_use() const {return used_num;} //how many buffers are borrowed currently
+
+	char* borrow()
+	{
+		++used_num;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!buffers.empty())
+			{
+				auto buff = buffers.back();
+				buffers.pop_back();
+				return buff;
+			}
+		}
+
+		return new char[buffer_size];
+	}
+
+	void give_back(char* buff)
+	{
+		assert(nullptr != buff);
+		--used_num;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (buffers.size() < max_idle_num)
+			{
+				buffers.push_back(buff);
+				return;
+			}
+		}
+
+		delete[] buff;
+	}
+
+private:
+	const size_t buffer_size, max_idle_num;
+	std::atomic_size_t used_num;
+
+	std::vector<char*> buffers;
+	std::mutex mutex;
+};
+inline buffer_pool& recv_buffer_pool() {static buffer_pool pool(ASCS_MSG_BUFFER_SIZE, ASCS_MAX_IDLE_RECV_BUFFER); return pool;}
+
+//a substitute of std::array<char, ASCS_MSG_BUFFER_SIZE> for unpackers, it uses a stub buffer until attach() is called.
+class pooled_recv_buffer : public asio::noncopyable
+{
+public:
+	pooled_recv_buffer() : buff(nullptr) {}
+	~pooled_recv_buffer() {detach();}
+
+	bool attached() const {return nullptr != buff;}
+	//borrow a buffer from recv_buffer_pool(), and move data_len bytes from the stub buffer to it.
+	void attach(size_t data_len) {if (nullptr == buff) {assert(data_len <= stub.size()); buff = recv_buffer_pool().borrow(); memcpy(buff, stub.data(), data_len);}}
+	void detach() {if (nullptr != buff) {recv_buffer_pool().give_back(buff); buff = nullptr;}}
+	//keep the pooled buffer if a half-baked msg is pending or more data are probably waiting in the SOCKET (the last read filled the whole buffer).
+	void adjust(size_t data_len, bool full) {if (data_len > 0 || full) attach(data_len); else detach();}
+
+	char* data() {return nullptr == buff ? stub.data() : buff;}
+	const char* data() const {return nullptr == buff ? stub.data() : buff;}
+	size_t size() const {return nullptr == buff ? stub.size() : ASCS_MSG_BUFFER_SIZE;}
+
+	char* begin() {return data();}
+	const char* begin() const {return data();}
+	char* end() {return std::next(data(), size());}
+	const char* end() const {return std::next(data(), size());}
+
+private:
+	char* buff;
+	std::array<char, ASCS_RECV_STUB_SIZE> stub;
+};
+#endif
+
 class cpu_timer //a substitute of boost::timer::cpu_timer
 {
 public:
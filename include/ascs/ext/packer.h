@@ -210,6 +210,88 @@ public:
 	virtual size_t raw_data_len(typename super::msg_ctype& msg) const {return msg.size() - ASCS_HEAD_LEN;}
 };
 
+//protocol: length + body, the same as packer, but the length header is stored inline in the message (see inline_header_msg),
+//so packing a moved message never allocates memory for the header, and the message occupies only one item in the send buffer.
+//tcp only, because the header and the body are sent as two buffers.
+class inline_header_packer : public i_packer<inline_header_msg>
+{
+public:
+	using i_packer<msg_type>::pack_msg;
+	virtual msg_type pack_msg(const char* const pstr[], const size_t len[], size_t num, bool native = false)
+	{
+		msg_type msg;
+		auto pre_len = native ? 0 : ASCS_HEAD_LEN;
+		auto total_len = packer_helper::msg_size_check(pre_len, pstr, len, num);
+		if ((size_t) -1 != total_len && total_len > pre_len)
+		{
+			if (!native)
+			{
+				auto head_len = (ASCS_HEAD_TYPE) total_len;
+				if (total_len != head_len)
+				{
+					unified_out::error_out("pack msg error: length exceeded the header's range!");
+					return msg;
+				}
+				msg.set_head(ASCS_HEAD_H2N(head_len));
+			}
+
+			msg.str().reserve(total_len - pre_len);
+			for (size_t i = 0; i < num; ++i)
+				if (nullptr != pstr[i])
+					msg.str().append(pstr[i], len[i]);
+		} //if (total_len > pre_len)
+
+		return msg;
+	}
+	virtual bool pack_msg(msg_type&& msg, container_type& msg_can)
+	{
+		msg.clear_head();
+		auto len = msg.size();
+		if (len > packer::get_max_msg_size())
+			return false;
+
+		msg.set_head(packer_helper::pack_header(len));
+		msg_can.emplace_back(std::move(msg));
+
+		return true;
+	}
+	virtual bool pack_msg(msg_type&& msg1, msg_type&& msg2, container_type& msg_can)
+	{
+		msg1.clear_head();
+		msg2.clear_head();
+		auto len = msg1.size() + msg2.size();
+		if (len > packer::get_max_msg_size()) //not considered overflow
+			return false;
+
+		msg1.set_head(packer_helper::pack_header(len));
+		msg_can.emplace_back(std::move(msg1));
+		msg_can.emplace_back(std::move(msg2));
+
+		return true;
+	}
+	virtual bool pack_msg(container_type&& in, container_type& out)
+	{
+		if (in.empty())
+			return false;
+
+		ascs::do_something_to_all(in, [](msg_type& msg) {msg.clear_head();});
+		auto len = ascs::get_size_in_byte(in);
+		if (len > packer::get_max_msg_size()) //not considered overflow
+			return false;
+
+		in.front().set_head(packer_helper::pack_header(len));
+		out.splice(std::end(out), in);
+
+		return true;
+	}
+	virtual msg_type pack_heartbeat() {msg_type msg; msg.set_head(packer_helper::pack_header(0)); return msg;}
+
+	//do not use following helper functions for heartbeat messages.
+	virtual char* raw_data(msg_type& msg) const {return const_cast<char*>(msg.data());}
+	virtual const char* raw_data(msg_ctype& msg) const {return msg.data();}
+	virtual size_t raw_data_len(msg_ctype& msg) const {return msg.size();}
+};
+
 //protocol: fixed length
 class fixed_length_packer : public packer
 {
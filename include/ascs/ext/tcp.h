@@ -40,6 +40,45 @@ typedef multi_client client;
 typedef ascs::tcp::server_socket_base<ASCS_DEFAULT_PACKER, ASCS_DEFAULT_UNPACKER> server_socket;
 typedef ascs::tcp::server_base<server_socket> server;
 
+#ifndef ASCS_DISPATCH_BATCH_MSG
+//dispatch chunks of big msgs via on_msg_chunk and normal msgs via on_whole_msg, the unpacker's msg_type must be msg_chunk (see chunked_unpacker).
+//with macro ASCS_DISPATCH_BATCH_MSG, please check msg_chunk::is_chunk() in on_msg_handle by yourself.
+template<typename Socket> class chunked_socket : public Socket
+{
+public:
+	template<typename Arg> chunked_socket(Arg&& arg) : Socket(std::forward<Arg>(arg)) {}
+	template<typename Arg1, typename Arg2> chunked_socket(Arg1&& arg1, Arg2&& arg2) : Socket(std::forward<Arg1>(arg1), std::forward<Arg2>(arg2)) {}
+
+protected:
+	//id identifies the big msg in this socket, offset is the position of data in the msg's body, last means data is the last chunk of the msg.
+	//chunks of the same msg are dispatched in order, return values have the same meaning as on_msg_handle's.
+	//notice: using inconstant is for the convenience of swapping
+	virtual bool on_msg_chunk(uint_fast64_t id, size_t offset, std::string& data, bool last)
+	{
+		unified_out::debug_out("recv chunk(" ASCS_LLF ", " ASCS_SF ", " ASCS_SF "%s)", id, offset, data.size(), last ? ", last" : "");
+		return true;
+	}
+	virtual bool on_whole_msg(typename Socket::out_msg_type& msg) {return Socket::on_msg_handle(msg);}
+
+#ifdef ASCS_SYNC_DISPATCH
+	//the default on_msg handles all msgs itself, chunks must be routed here too, stop at the first msg that cannot be handled right now,
+	// it and the msgs after it will be dispatched asynchronously (via on_msg_handle) in order.
+	virtual size_t on_msg(list<typename Socket::out_msg_type>& msg_can)
+	{
+		size_t handled = 0;
+		while (!msg_can.empty() && on_msg_handle(msg_can.front()))
+		{
+			msg_can.pop_front();
+			++handled;
+		}
+
+		return handled;
+	}
+#endif
+	virtual bool on_msg_handle(typename Socket::out_msg_type& msg) {return msg.is_chunk() ? on_msg_chunk(msg.id(), msg.offset(), msg, msg.last()) : on_whole_msg(msg);}
+};
+#endif
+
 }}} //namespace
 
 #endif /* _ASCS_EXT_TCP_H_ */
@@ -17,8 +17,26 @@
 
 #include "ext.h"
 
+//used by prefix_suffix_unpacker::memmem, AVX2 (32 bytes per step) or SSE2 (16 bytes per step) will be used if available at compile time.
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define ASCS_SIMD_WIDTH	32
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ASCS_SIMD_WIDTH	16
+#endif
+#if defined(ASCS_SIMD_WIDTH) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 namespace ascs { namespace ext {
 
+#ifdef ASCS_POOLED_RECV_BUFFER
+typedef pooled_recv_buffer raw_buffer_type;
+#else
+typedef std::array<char, ASCS_MSG_BUFFER_SIZE> raw_buffer_type;
+#endif
+
 //protocol: length + body
 class unpacker : public i_unpacker<std::string>
 {
@@ -60,16 +78,28 @@ public:
 			else
 				break;
 
-		if (pnext == &*std::begin(raw_buff)) //we should have at least got one msg.
-			unpack_ok = false;
+		if (pnext == &*std::begin(raw_buff)) //we should have at least got one msg, unless in read-some mode (see i_unpacker::read_some)
+#ifdef ASCS_POOLED_RECV_BUFFER
+			//or the stub buffer is full, see macro ASCS_POOLED_RECV_BUFFER
+			unpack_ok = unpack_ok && (read_some() || (!raw_buff.attached() && remain_len == raw_buff.size()));
+#else
+			unpack_ok = unpack_ok && read_some();
+#endif
 
 		return unpack_ok;
 	}
 
 public:
+#ifdef ASCS_POOLED_RECV_BUFFER
+	virtual void reset() {cur_msg_len = -1; remain_len = 0; raw_buff.detach();}
+#else
 	virtual void reset() {cur_msg_len = -1; remain_len = 0;}
+#endif
 	virtual bool parse_msg(size_t bytes_transferred, container_type& msg_can)
 	{
+#ifdef ASCS_POOLED_RECV_BUFFER
+		auto full = remain_len + bytes_transferred == raw_buff.size();
+#endif
 		std::list<std::pair<const char*, size_t>> msg_pos_can;
 		auto unpack_ok = parse_msg(bytes_transferred, msg_pos_can);
 		do_something_to_all(msg_pos_can, [this, &msg_can](decltype(msg_pos_can.front()) item) {
@@ -87,6 +117,9 @@ public:
 			auto pnext = std::next(msg_pos_can.back().first, msg_pos_can.back().second);
 			memmove(&*std::begin(raw_buff), pnext, remain_len); //left behind unparsed data
 		}
+#ifdef ASCS_POOLED_RECV_BUFFER
+		raw_buff.adjust(remain_len, full);
+#endif
 
 		//if unpacking failed, successfully parsed msgs will still returned via msg_can(sticky package), please note.
 		return unpack_ok;
@@ -117,8 +150,256 @@ public:
 	}
 
 #ifdef ASCS_SCATTERED_RECV_BUFFER
-	//this is just to satisfy the compiler, it's not a real scatter-gather buffer,
-	//if you introduce a ring buffer, then you will have the chance to provide a real scatter-gather buffer.
+	//this is just to satisfy the compiler, it's not a real scatter-gather buffer, see ring_unpacker for a real one.
+	virtual buffer_type prepare_next_recv() {assert(remain_len < raw_buff.size()); return buffer_type(1, asio::buffer(raw_buff.data(), raw_buff.size()) + remain_len);}
+#else
+	virtual buffer_type prepare_next_recv() {assert(remain_len < raw_buff.size()); return asio::buffer(asio::buffer(raw_buff.data(), raw_buff.size()) + remain_len);}
+#endif
+
+protected:
+	raw_buffer_type raw_buff;
+	size_t cur_msg_len; //-1 means head not received, so msg length is not available.
+	size_t remain_len; //half-baked msg
+};
+
+#ifdef ASCS_SCATTERED_RECV_BUFFER
+//protocol: length + body
+//same protocol as unpacker, but raw_buff is used as a ring buffer, so no memmove is needed after parsing, the free space (at most two parts,
+//one before and one after the wrap point) will be returned as scatter-gather buffers by prepare_next_recv.
+//only messages which straddle the wrap point need to be reassembled (from two parts).
+//this unpacker is only available with macro ASCS_SCATTERED_RECV_BUFFER, and ASCS_RECV_BUFFER_TYPE must be std::vector<asio::mutable_buffer>.
+class ring_unpacker : public i_unpacker<std::string>
+{
+public:
+	ring_unpacker() {reset();}
+	size_t current_msg_length() const {return cur_msg_len;} //current msg's total length, -1 means not available
+
+public:
+	virtual void reset() {cur_msg_len = -1; begin_pos = 0; remain_len = 0;}
+	virtual bool parse_msg(size_t bytes_transferred, container_type& msg_can)
+	{
+		//length + msg
+		remain_len += bytes_transferred;
+		assert(remain_len <= ASCS_MSG_BUFFER_SIZE);
+
+		auto got_msg = false;
+		auto unpack_ok = true;
+		while (unpack_ok) //considering sticky package problem, we need a loop
+			if ((size_t) -1 != cur_msg_len)
+			{
+				if (cur_msg_len > ASCS_MSG_BUFFER_SIZE || cur_msg_len < ASCS_HEAD_LEN)
+					unpack_ok = false;
+				else if (remain_len >= cur_msg_len) //one msg received
+				{
+					if (cur_msg_len > ASCS_HEAD_LEN) //ignore heartbeat
+					{
+						if (stripped())
+							emplace_msg(wrap(begin_pos + ASCS_HEAD_LEN), cur_msg_len - ASCS_HEAD_LEN, msg_can);
+						else
+							emplace_msg(begin_pos, cur_msg_len, msg_can);
+					}
+
+					remain_len -= cur_msg_len;
+					begin_pos = 0 == remain_len ? 0 : wrap(begin_pos + cur_msg_len); //rewind to make the next receiving continuous as possible
+					cur_msg_len = -1;
+					got_msg = true;
+				}
+				else
+					break;
+			}
+			else if (remain_len >= ASCS_HEAD_LEN) //the msg's head been received, sticky package found
+			{
+				cur_msg_len = read_head();
+				if ((size_t) -1 == cur_msg_len) //avoid dead loop on 32bit system with macro ASCS_HUGE_MSG
+					unpack_ok = false;
+			}
+			else
+				break;
+
+		//if unpacking failed, successfully parsed msgs will still returned via msg_can(sticky package), please note.
+		return (got_msg || read_some()) && unpack_ok; //we should have at least got one msg, unless in read-some mode (see i_unpacker::read_some)
+	}
+
+	virtual size_t completion_condition(const asio::error_code& ec, size_t bytes_transferred)
+	{
+		if (ec)
+			return 0;
+
+		auto data_len = remain_len + bytes_transferred;
+		assert(data_len <= ASCS_MSG_BUFFER_SIZE);
+
+		if ((size_t) -1 == cur_msg_len && data_len >= ASCS_HEAD_LEN) //the msg's head been received
+		{
+			cur_msg_len = read_head();
+			if (cur_msg_len > ASCS_MSG_BUFFER_SIZE || cur_msg_len < ASCS_HEAD_LEN) //invalid msg, stop reading
+				return 0;
+		}
+
+		return data_len >= cur_msg_len ? 0 : asio::detail::default_max_transfer_size;
+		//read as many as possible except that we have already got an entire msg
+	}
+
+	virtual buffer_type prepare_next_recv()
+	{
+		assert(remain_len < ASCS_MSG_BUFFER_SIZE);
+
+		buffer_type buffers;
+		auto end_pos = wrap(begin_pos + remain_len);
+		if (end_pos < begin_pos) //the free space is continuous
+			buffers.emplace_back(std::next(raw_buff.data(), end_pos), begin_pos - end_pos);
+		else //the free space may be split by the wrap point
+		{
+			buffers.emplace_back(std::next(raw_buff.data(), end_pos), ASCS_MSG_BUFFER_SIZE - end_pos);
+			if (begin_pos > 0)
+				buffers.emplace_back(raw_buff.data(), begin_pos);
+		}
+
+		return buffers;
+	}
+
+protected:
+	size_t wrap(size_t pos) const {return pos >= ASCS_MSG_BUFFER_SIZE ? pos - ASCS_MSG_BUFFER_SIZE : pos;}
+	size_t read_head() const
+	{
+		ASCS_HEAD_TYPE head;
+		auto first_len = std::min((size_t) ASCS_HEAD_LEN, ASCS_MSG_BUFFER_SIZE - begin_pos);
+		memcpy(&head, std::next(raw_buff.data(), begin_pos), first_len);
+		if (first_len < ASCS_HEAD_LEN) //the head straddles the wrap point
+			memcpy(std::next((char*) &head, first_len), raw_buff.data(), ASCS_HEAD_LEN - first_len);
+
+		return ASCS_HEAD_N2H(head);
+	}
+
+	void emplace_msg(size_t pos, size_t len, container_type& msg_can) const
+	{
+		auto first_len = ASCS_MSG_BUFFER_SIZE - pos;
+		if (len <= first_len)
+			msg_can.emplace_back(std::next(raw_buff.data(), pos), len);
+		else //the msg straddles the wrap point, reassemble it
+		{
+			msg_can.emplace_back();
+			auto& msg = msg_can.back();
+			msg.reserve(len);
+			msg.append(std::next(raw_buff.data(), pos), first_len).append(raw_buff.data(), len - first_len);
+		}
+	}
+
+protected:
+	std::array<char, ASCS_MSG_BUFFER_SIZE> raw_buff;
+	size_t cur_msg_len; //-1 means head not received, so msg length is not available.
+	size_t begin_pos; //where the half-baked msg begins
+	size_t remain_len; //half-baked msg
+};
+#endif
+
+//protocol: length + body
+//same protocol as unpacker, but msgs bigger than ASCS_MSG_BUFFER_SIZE (the length is still limited by ASCS_HEAD_TYPE) are not treated as errors,
+//they will be delivered chunk by chunk (see msg_chunk) as soon as data arrive, so the memory usage is bounded (by ASCS_MSG_BUFFER_SIZE and
+//ASCS_MAX_RECV_BUF) no matter how big the msgs are. small msgs will be delivered as usual on the same connection.
+//chunks never include the head no matter stripped() or not, use ext::tcp::chunked_socket to dispatch them via on_msg_chunk.
+class chunked_unpacker : public i_unpacker<msg_chunk>
+{
+public:
+	chunked_unpacker() : next_id(0) {reset();}
+	size_t current_msg_length() const {return cur_msg_len;} //current msg's total length, -1 means not available
+
+public:
+	virtual void reset() {cur_msg_len = -1; remain_len = 0; chunk_left = 0;}
+	virtual bool parse_msg(size_t bytes_transferred, container_type& msg_can)
+	{
+		//length + msg
+		remain_len += bytes_transferred;
+		assert(remain_len <= ASCS_MSG_BUFFER_SIZE);
+
+		auto pnext = &*std::begin(raw_buff);
+		auto unpack_ok = true;
+		while (unpack_ok && remain_len > 0) //considering sticky package problem, we need a loop
+			if (chunk_left > 0) //in the middle of a big msg
+			{
+				auto len = std::min(remain_len, chunk_left);
+				chunk_left -= len;
+				msg_can.emplace_back(chunk_id, chunk_offset, pnext, len, 0 == chunk_left);
+				chunk_offset += len;
+				remain_len -= len;
+				std::advance(pnext, len);
+			}
+			else if ((size_t) -1 != cur_msg_len)
+			{
+				if (cur_msg_len < ASCS_HEAD_LEN)
+					unpack_ok = false;
+				else if (cur_msg_len > ASCS_MSG_BUFFER_SIZE) //a big msg, skip the head and deliver the body chunk by chunk
+				{
+					chunk_id = ++next_id;
+					chunk_offset = 0;
+					chunk_left = cur_msg_len - ASCS_HEAD_LEN;
+					remain_len -= ASCS_HEAD_LEN;
+					std::advance(pnext, ASCS_HEAD_LEN);
+					cur_msg_len = -1;
+				}
+				else if (remain_len >= cur_msg_len) //one msg received
+				{
+					if (cur_msg_len > ASCS_HEAD_LEN) //ignore heartbeat
+					{
+						if (stripped())
+							msg_can.emplace_back(std::next(pnext, ASCS_HEAD_LEN), cur_msg_len - ASCS_HEAD_LEN);
+						else
+							msg_can.emplace_back(pnext, cur_msg_len);
+					}
+					remain_len -= cur_msg_len;
+					std::advance(pnext, cur_msg_len);
+					cur_msg_len = -1;
+				}
+				else
+					break;
+			}
+			else if (remain_len >= ASCS_HEAD_LEN) //the msg's head been received, sticky package found
+			{
+				ASCS_HEAD_TYPE head;
+				memcpy(&head, pnext, ASCS_HEAD_LEN);
+				cur_msg_len = ASCS_HEAD_N2H(head);
+				if ((size_t) -1 == cur_msg_len) //avoid dead loop on 32bit system with macro ASCS_HUGE_MSG
+					unpack_ok = false;
+			}
+			else
+				break;
+
+		//we should have at least got one msg (or chunk, or the head of a big msg), unless in read-some mode (see i_unpacker::read_some)
+		if (pnext == &*std::begin(raw_buff))
+			unpack_ok = unpack_ok && read_some();
+		else if (remain_len > 0)
+			memmove(&*std::begin(raw_buff), pnext, remain_len); //left behind unparsed data
+
+		//if unpacking failed, successfully parsed msgs will still returned via msg_can(sticky package), please note.
+		return unpack_ok;
+	}
+
+	virtual size_t completion_condition(const asio::error_code& ec, size_t bytes_transferred)
+	{
+		if (ec)
+			return 0;
+		else if (chunk_left > 0) //deliver chunks as soon as possible
+			return bytes_transferred > 0 ? 0 : asio::detail::default_max_transfer_size;
+
+		auto data_len = remain_len + bytes_transferred;
+		assert(data_len <= ASCS_MSG_BUFFER_SIZE);
+
+		if ((size_t) -1 == cur_msg_len)
+		{
+			if (data_len < ASCS_HEAD_LEN)
+				return asio::detail::default_max_transfer_size;
+
+			ASCS_HEAD_TYPE head;
+			memcpy(&head, &*std::begin(raw_buff), ASCS_HEAD_LEN);
+			cur_msg_len = ASCS_HEAD_N2H(head);
+			if ((size_t) -1 == cur_msg_len || cur_msg_len < ASCS_HEAD_LEN) //invalid msg, stop reading
+				return 0;
+		}
+
+		return data_len >= cur_msg_len || cur_msg_len > ASCS_MSG_BUFFER_SIZE ? 0 : asio::detail::default_max_transfer_size;
+		//read as many as possible except that we have already got an entire msg or the head of a big msg
+	}
+
+#ifdef ASCS_SCATTERED_RECV_BUFFER
 	virtual buffer_type prepare_next_recv() {assert(remain_len < ASCS_MSG_BUFFER_SIZE); return buffer_type(1, asio::buffer(raw_buff) + remain_len);}
 #else
 	virtual buffer_type prepare_next_recv() {assert(remain_len < ASCS_MSG_BUFFER_SIZE); return asio::buffer(asio::buffer(raw_buff) + remain_len);}
@@ -128,6 +409,9 @@ protected:
 	std::array<char, ASCS_MSG_BUFFER_SIZE> raw_buff;
 	size_t cur_msg_len; //-1 means head not received, so msg length is not available.
 	size_t remain_len; //half-baked msg
+
+	uint_fast64_t next_id, chunk_id;
+	size_t chunk_offset, chunk_left; //chunk_left is the size of the big msg's body which has not been received, 0 means no big msg in progress
 };
 
 //protocol: UDP has message boundary, so we don't need a specific protocol to unpack it.
@@ -164,6 +448,7 @@ public:
 	{
 		unpacker::container_type tmp_can;
 		unpacker_.stripped(this->stripped());
+		unpacker_.read_some(this->read_some());
 		auto unpack_ok = unpacker_.parse_msg(bytes_transferred, tmp_can);
 		do_something_to_all(tmp_can, [&msg_can](unpacker::msg_type& item) {
 			auto raw_msg = new string_buffer();
@@ -217,6 +502,7 @@ protected:
 //let asio write msg directly (no temporary memory needed), not support unstripped messages, please note (you can fix this defect if you like).
 //actually, this unpacker has the worst performance, because it needs 2 read for one message, other unpackers are able to get many messages from just one read.
 //so this unpacker just demonstrates a way to avoid memory replications and temporary memory utilization, it can provide better performance for huge messages.
+//if you have both small and huge messages, please use hybrid_unpacker.
 //this unpacker only output stripped messages, please note.
 class non_copy_unpacker : public i_unpacker<basic_buffer>
 {
@@ -294,10 +580,264 @@ private:
 	int step; //-1-error format, 0-want the head, 1-want the body
 };
 
+//protocol: length + body
+//a hybrid of unpacker and non_copy_unpacker, it reads into a small staging buffer (ASCS_STAGING_BUFFER_SIZE), msgs which can be held in it will be
+//parsed from it (many msgs per read, like unpacker), once the head of a bigger msg appears, a buffer with exactly the msg's size will be allocated,
+//data already in the staging buffer will be copied into it, and the rest of the msg will be read directly into it (like non_copy_unpacker).
+//so small msgs don't need 2 reads for one msg, and big msgs don't need a fixed buffer with the biggest msg size.
+class hybrid_unpacker : public i_unpacker<basic_buffer>
+{
+public:
+	hybrid_unpacker() {reset();}
+	size_t current_msg_length() const {return cur_msg_len;} //current msg's total length, -1 means not available
+
+public:
+	virtual void reset() {cur_msg_len = -1; remain_len = 0; big_msg.clear(); big_received = 0;}
+	virtual bool parse_msg(size_t bytes_transferred, container_type& msg_can)
+	{
+		if (!big_msg.empty()) //the rest of a big msg been read directly
+		{
+			big_received += bytes_transferred;
+			assert(big_received <= big_msg.size());
+			if (big_received < big_msg.size())
+				return read_some(); //see i_unpacker::read_some
+
+			msg_can.emplace_back(std::move(big_msg));
+			big_received = 0;
+			return true;
+		}
+
+		//length + msg
+		remain_len += bytes_transferred;
+		assert(remain_len <= ASCS_STAGING_BUFFER_SIZE);
+
+		auto pnext = &*std::begin(raw_buff);
+		auto unpack_ok = true;
+		while (unpack_ok) //considering sticky package problem, we need a loop
+			if ((size_t) -1 != cur_msg_len)
+			{
+				if (cur_msg_len > ASCS_MSG_BUFFER_SIZE || cur_msg_len < ASCS_HEAD_LEN)
+					unpack_ok = false;
+				else if (cur_msg_len > ASCS_STAGING_BUFFER_SIZE) //a big msg, all data left behind belong to it
+				{
+					auto skip_len = stripped() ? ASCS_HEAD_LEN : 0;
+					big_msg.assign(cur_msg_len - skip_len);
+					big_received = remain_len - skip_len;
+					memcpy(big_msg.data(), std::next(pnext, skip_len), big_received);
+
+					std::advance(pnext, remain_len);
+					remain_len = 0;
+					cur_msg_len = -1;
+					break;
+				}
+				else if (remain_len >= cur_msg_len) //one msg received
+				{
+					if (cur_msg_len > ASCS_HEAD_LEN) //ignore heartbeat
+					{
+						auto skip_len = stripped() ? ASCS_HEAD_LEN : 0;
+						msg_can.emplace_back(cur_msg_len - skip_len);
+						memcpy(msg_can.back().data(), std::next(pnext, skip_len), cur_msg_len - skip_len);
+					}
+					remain_len -= cur_msg_len;
+					std::advance(pnext, cur_msg_len);
+					cur_msg_len = -1;
+				}
+				else
+					break;
+			}
+			else if (remain_len >= ASCS_HEAD_LEN) //the msg's head been received, sticky package found
+			{
+				ASCS_HEAD_TYPE head;
+				memcpy(&head, pnext, ASCS_HEAD_LEN);
+				cur_msg_len = ASCS_HEAD_N2H(head);
+				if ((size_t) -1 == cur_msg_len) //avoid dead loop on 32bit system with macro ASCS_HUGE_MSG
+					unpack_ok = false;
+			}
+			else
+				break;
+
+		//we should have at least got one msg (or the beginning of a big msg), unless in read-some mode (see i_unpacker::read_some)
+		if (pnext == &*std::begin(raw_buff))
+			unpack_ok = unpack_ok && read_some();
+		else if (remain_len > 0)
+			memmove(&*std::begin(raw_buff), pnext, remain_len); //left behind unparsed data
+
+		//if unpacking failed, successfully parsed msgs will still returned via msg_can(sticky package), please note.
+		return unpack_ok;
+	}
+
+	//a return value of 0 indicates that the read operation is complete. a non-zero value indicates the maximum number
+	//of bytes to be read on the next call to the stream's async_read_some function. ---asio::async_read
+	virtual size_t completion_condition(const asio::error_code& ec, size_t bytes_transferred)
+	{
+		if (ec)
+			return 0;
+		else if (!big_msg.empty())
+			return big_received + bytes_transferred >= big_msg.size() ? 0 : asio::detail::default_max_transfer_size;
+
+		auto data_len = remain_len + bytes_transferred;
+		assert(data_len <= ASCS_STAGING_BUFFER_SIZE);
+
+		if ((size_t) -1 == cur_msg_len && data_len >= ASCS_HEAD_LEN) //the msg's head been received
+		{
+			ASCS_HEAD_TYPE head;
+			memcpy(&head, &*std::begin(raw_buff), ASCS_HEAD_LEN);
+			cur_msg_len = ASCS_HEAD_N2H(head);
+			if (cur_msg_len > ASCS_MSG_BUFFER_SIZE || cur_msg_len < ASCS_HEAD_LEN) //invalid msg, stop reading
+				return 0;
+		}
+
+		return data_len >= cur_msg_len || (cur_msg_len > ASCS_STAGING_BUFFER_SIZE && (size_t) -1 != cur_msg_len) ? 0 : asio::detail::default_max_transfer_size;
+		//read as many as possible except that we have already got an entire msg or the head of a big msg
+	}
+
+#ifdef ASCS_SCATTERED_RECV_BUFFER
+	virtual buffer_type prepare_next_recv() {return buffer_type(1, do_prepare_next_recv());}
+#else
+	virtual buffer_type prepare_next_recv() {return do_prepare_next_recv();}
+#endif
+
+private:
+	asio::mutable_buffer do_prepare_next_recv()
+	{
+		if (!big_msg.empty())
+			return asio::buffer(std::next(big_msg.data(), big_received), big_msg.size() - big_received);
+
+		assert(remain_len < ASCS_STAGING_BUFFER_SIZE);
+		return asio::buffer(asio::buffer(raw_buff) + remain_len);
+	}
+
+private:
+	std::array<char, ASCS_STAGING_BUFFER_SIZE> raw_buff;
+	size_t cur_msg_len; //-1 means head not received, so msg length is not available.
+	size_t remain_len; //half-baked msg
+
+	msg_type big_msg; //the big msg being received directly
+	size_t big_received;
+};
+
+//protocol: length + body
+//read into a reference-counted slab (see slab_type), and output slab_msg which shares the slab, so msgs from one read need zero memory replication
+//and only one memory allocation in total (the slab, and only if the last slab is still being referenced by some msgs, otherwise it will be reused).
+class slab_unpacker : public i_unpacker<slab_msg>
+{
+public:
+	slab_unpacker() {reset();}
+	size_t current_msg_length() const {return cur_msg_len;} //current msg's total length, -1 means not available
+
+public:
+	virtual void reset() {cur_msg_len = -1; remain_len = 0; begin_pos = 0;}
+	virtual bool parse_msg(size_t bytes_transferred, container_type& msg_can)
+	{
+		//length + msg
+		remain_len += bytes_transferred;
+		assert(0 == begin_pos && remain_len <= ASCS_MSG_BUFFER_SIZE);
+
+		auto pnext = slab->data();
+		auto unpack_ok = true;
+		while (unpack_ok) //considering sticky package problem, we need a loop
+			if ((size_t) -1 != cur_msg_len)
+			{
+				if (cur_msg_len > ASCS_MSG_BUFFER_SIZE || cur_msg_len < ASCS_HEAD_LEN)
+					unpack_ok = false;
+				else if (remain_len >= cur_msg_len) //one msg received
+				{
+					if (cur_msg_len > ASCS_HEAD_LEN) //ignore heartbeat
+					{
+						if (stripped())
+							msg_can.emplace_back(slab, std::next(pnext, ASCS_HEAD_LEN), cur_msg_len - ASCS_HEAD_LEN);
+						else
+							msg_can.emplace_back(slab, pnext, cur_msg_len);
+					}
+					remain_len -= cur_msg_len;
+					std::advance(pnext, cur_msg_len);
+					cur_msg_len = -1;
+				}
+				else
+					break;
+			}
+			else if (remain_len >= ASCS_HEAD_LEN) //the msg's head been received, sticky package found
+			{
+				ASCS_HEAD_TYPE head;
+				memcpy(&head, pnext, ASCS_HEAD_LEN);
+				cur_msg_len = ASCS_HEAD_N2H(head);
+				if ((size_t) -1 == cur_msg_len) //avoid dead loop on 32bit system with macro ASCS_HUGE_MSG
+					unpack_ok = false;
+			}
+			else
+				break;
+
+		if (pnext == slab->data()) //we should have at least got one msg, unless in read-some mode (see i_unpacker::read_some)
+			unpack_ok = unpack_ok && read_some();
+		//left behind unparsed data will be moved in prepare_next_recv, because msgs may still need the slab after they been parsed
+		begin_pos = std::distance(slab->data(), pnext);
+
+		//if unpacking failed, successfully parsed msgs will still returned via msg_can(sticky package), please note.
+		return unpack_ok;
+	}
+
+	//a return value of 0 indicates that the read operation is complete. a non-zero value indicates the maximum number
+	//of bytes to be read on the next call to the stream's async_read_some function. ---asio::async_read
+	virtual size_t completion_condition(const asio::error_code& ec, size_t bytes_transferred)
+	{
+		if (ec)
+			return 0;
+
+		auto data_len = remain_len + bytes_transferred;
+		assert(data_len <= ASCS_MSG_BUFFER_SIZE);
+
+		if ((size_t) -1 == cur_msg_len && data_len >= ASCS_HEAD_LEN) //the msg's head been received
+		{
+			ASCS_HEAD_TYPE head;
+			memcpy(&head, slab->data(), ASCS_HEAD_LEN);
+			cur_msg_len = ASCS_HEAD_N2H(head);
+			if (cur_msg_len > ASCS_MSG_BUFFER_SIZE || cur_msg_len < ASCS_HEAD_LEN) //invalid msg, stop reading
+				return 0;
+		}
+
+		return data_len >= cur_msg_len ? 0 : asio::detail::default_max_transfer_size;
+		//read as many as possible except that we have already got an entire msg
+	}
+
+#ifdef ASCS_SCATTERED_RECV_BUFFER
+	virtual buffer_type prepare_next_recv() {return buffer_type(1, do_prepare_next_recv());}
+#else
+	virtual buffer_type prepare_next_recv() {return do_prepare_next_recv();}
+#endif
+
+private:
+	asio::mutable_buffer do_prepare_next_recv()
+	{
+		assert(remain_len < ASCS_MSG_BUFFER_SIZE);
+		if (slab && 1 == slab.use_count()) //no msgs reference the slab any more, reuse it
+		{
+			std::atomic_thread_fence(std::memory_order_acquire); //synchronize with the releasing of the slab by other threads
+			if (begin_pos > 0 && remain_len > 0)
+				memmove(slab->data(), std::next(slab->data(), begin_pos), remain_len);
+		}
+		else
+		{
+			auto new_slab = std::make_shared<slab_type>();
+			if (remain_len > 0)
+				memcpy(new_slab->data(), std::next(slab->data(), begin_pos), remain_len);
+			slab.swap(new_slab);
+		}
+		begin_pos = 0;
+
+		return asio::buffer(asio::buffer(*slab) + remain_len);
+	}
+
+private:
+	std::shared_ptr<slab_type> slab;
+	size_t cur_msg_len; //-1 means head not received, so msg length is not available.
+	size_t remain_len; //half-baked msg
+	size_t begin_pos; //where the half-baked msg begins in the slab
+};
+
 //protocol: fixed length
 //non-copy, let asio write msg directly (no temporary memory needed), actually, this unpacker has poor performance, because it needs one read for one message, other unpackers
 //are able to get many messages from just one read, so this unpacker just demonstrates a way to avoid memory replications and temporary memory utilization, it can provide better
-// performance for huge messages.
+// performance for huge messages. for small messages, please use batch_fixed_length_unpacker.
 //this unpacker doesn't support heartbeat, please note.
 class fixed_length_unpacker : public i_unpacker<basic_buffer>
 {
@@ -336,13 +876,109 @@ private:
 	size_t _fixed_length;
 };
 
+//protocol: fixed length
+//unlike fixed_length_unpacker, this unpacker reads into a fixed buffer and slices out as many complete msgs as arrived in one read
+//(keeping the partial tail for the next read), so it's much more efficient for small msgs (for example, 64 bytes frames).
+//msgs with fixed length equal to or bigger than non_copy_threshold will be read directly into their own buffers (just like fixed_length_unpacker does),
+//the default threshold means msgs which are longer than half of ASCS_MSG_BUFFER_SIZE (only one msg can be held in the fixed buffer anyway).
+//this unpacker doesn't support heartbeat, please note.
+class batch_fixed_length_unpacker : public i_unpacker<basic_buffer>
+{
+public:
+	batch_fixed_length_unpacker() : _fixed_length(1024), _non_copy_threshold(ASCS_MSG_BUFFER_SIZE / 2 + 1) {reset();}
+
+	void fixed_length(size_t fixed_length) {assert(0 < fixed_length && fixed_length <= ASCS_MSG_BUFFER_SIZE); _fixed_length = fixed_length;}
+	size_t fixed_length() const {return _fixed_length;}
+	void non_copy_threshold(size_t threshold) {_non_copy_threshold = threshold;}
+	size_t non_copy_threshold() const {return _non_copy_threshold;}
+
+public:
+	virtual void reset() {remain_len = 0; big_msg.clear(); big_received = 0;}
+	virtual bool parse_msg(size_t bytes_transferred, container_type& msg_can)
+	{
+		if (!big_msg.empty()) //non-copy
+		{
+			big_received += bytes_transferred;
+			assert(big_received <= big_msg.size());
+			if (big_received < big_msg.size())
+				return read_some(); //see i_unpacker::read_some
+
+			msg_can.emplace_back(std::move(big_msg));
+			big_received = 0;
+			return true;
+		}
+
+		remain_len += bytes_transferred;
+		assert(remain_len <= ASCS_MSG_BUFFER_SIZE);
+
+		auto pnext = raw_buff.data();
+		for (; remain_len >= _fixed_length; remain_len -= _fixed_length, std::advance(pnext, _fixed_length))
+		{
+			msg_can.emplace_back(_fixed_length);
+			memcpy(msg_can.back().data(), pnext, _fixed_length);
+		}
+
+		if (pnext == raw_buff.data()) //we should have at least got one msg, unless in read-some mode (see i_unpacker::read_some)
+			return read_some();
+		else if (remain_len > 0)
+			memmove(raw_buff.data(), pnext, remain_len); //left behind unparsed data
+
+		return true;
+	}
+
+	//a return value of 0 indicates that the read operation is complete. a non-zero value indicates the maximum number
+	//of bytes to be read on the next call to the stream's async_read_some function. ---asio::async_read
+	virtual size_t completion_condition(const asio::error_code& ec, size_t bytes_transferred)
+	{
+		if (ec)
+			return 0;
+		else if (!big_msg.empty())
+			return big_received + bytes_transferred >= big_msg.size() ? 0 : asio::detail::default_max_transfer_size;
+
+		return remain_len + bytes_transferred >= _fixed_length ? 0 : asio::detail::default_max_transfer_size;
+		//read as many as possible except that we have already got at least one entire msg
+	}
+
+#ifdef ASCS_SCATTERED_RECV_BUFFER
+	virtual buffer_type prepare_next_recv() {return buffer_type(1, do_prepare_next_recv());}
+#else
+	virtual buffer_type prepare_next_recv() {return do_prepare_next_recv();}
+#endif
+
+private:
+	asio::mutable_buffer do_prepare_next_recv()
+	{
+		if (big_msg.empty() && 0 == remain_len && _fixed_length >= _non_copy_threshold) //switch to non-copy only if no partial msg left behind
+		{
+			big_msg.assign(_fixed_length);
+			big_received = 0;
+		}
+
+		if (!big_msg.empty())
+			return asio::buffer(std::next(big_msg.data(), big_received), big_msg.size() - big_received);
+
+		assert(remain_len < ASCS_MSG_BUFFER_SIZE);
+		return asio::buffer(asio::buffer(raw_buff) + remain_len);
+	}
+
+private:
+	std::array<char, ASCS_MSG_BUFFER_SIZE> raw_buff;
+	size_t remain_len; //half-baked msg
+
+	basic_buffer big_msg; //the msg being received directly (non-copy)
+	size_t big_received;
+
+	size_t _fixed_length, _non_copy_threshold;
+};
+
 //protocol: [prefix] + body + suffix
 class prefix_suffix_unpacker : public i_unpacker<std::string>
 {
 public:
 	prefix_suffix_unpacker() {reset();}
 
-	void prefix_suffix(const std::string& prefix, const std::string& suffix) {assert(!suffix.empty() && prefix.size() + suffix.size() < ASCS_MSG_BUFFER_SIZE); _prefix = prefix; _suffix = suffix;}
+	void prefix_suffix(const std::string& prefix, const std::string& suffix)
+		{assert(!suffix.empty() && prefix.size() + suffix.size() < ASCS_MSG_BUFFER_SIZE); _prefix = prefix; _suffix = suffix; scan_pos = 0;}
 	const std::string& prefix() const {return _prefix;}
 	const std::string& suffix() const {return _suffix;}
 
@@ -366,7 +1002,9 @@ public:
 		auto min_len = _prefix.size() + _suffix.size();
 		if (data_len > min_len)
 		{
-			auto end = (const char*) memmem(std::next(buff, _prefix.size()), data_len - _prefix.size(), _suffix.data(), _suffix.size());
+			//resume from where the last scanning stopped rather than from the beginning, data (before data_len) must not change between two calls.
+			auto begin_pos = std::max(scan_pos, _prefix.size());
+			auto end = (const char*) memmem(std::next(buff, begin_pos), data_len - begin_pos, _suffix.data(), _suffix.size());
 			if (nullptr != end)
 			{
 				cur_msg_len = std::distance(buff, end) + _suffix.size(); //got a msg
@@ -374,32 +1012,65 @@ public:
 			}
 			else if (data_len >= ASCS_MSG_BUFFER_SIZE)
 				return 0; //invalid msg, stop reading
+
+			scan_pos = data_len - _suffix.size() + 1; //the suffix may straddle the end of current data
 		}
 
 		return asio::detail::default_max_transfer_size; //read as many as possible
 	}
 
 	//like strstr, except support \0 in the middle of mem and sub_mem
+	//with SIMD, candidates are found by comparing the first and the last byte of sub_mem at ASCS_SIMD_WIDTH positions at a time,
+	//otherwise (or sub_mem has only one byte), by memchr (which is already vectorized by most C runtime libraries) on the first byte of sub_mem,
+	//then only candidates need memcmp.
 	static const void* memmem(const void* mem, size_t len, const void* sub_mem, size_t sub_len)
 	{
-		if (nullptr != mem && nullptr != sub_mem && sub_len <= len)
+		if (nullptr == mem || nullptr == sub_mem || sub_len > len)
+			return nullptr;
+		else if (0 == sub_len)
+			return mem;
+
+		auto p = (const char*) mem, sub = (const char*) sub_mem;
+		auto valid_len = len - sub_len; //the last position that sub_mem can begin at
+		size_t i = 0;
+#ifdef ASCS_SIMD_WIDTH
+		if (sub_len > 1)
+			for (; i + ASCS_SIMD_WIDTH <= valid_len + 1; i += ASCS_SIMD_WIDTH)
+				for (auto mask = candidates(std::next(p, i), sub, sub_len); 0 != mask; mask &= mask - 1)
+				{
+					auto candidate = std::next(p, i + lowest_bit(mask));
+					if (0 == memcmp(std::next(candidate, 1), std::next(sub, 1), sub_len - 1))
+						return candidate;
+				}
+#endif
+		while (i <= valid_len)
 		{
-			auto valid_len = len - sub_len;
-			for (size_t i = 0; i <= valid_len; ++i, mem = (const char*) mem + 1)
-				if (0 == memcmp(mem, sub_mem, sub_len))
-					return mem;
+			auto candidate = (const char*) memchr(std::next(p, i), *sub, valid_len - i + 1);
+			if (nullptr == candidate)
+				break;
+			else if (0 == memcmp(std::next(candidate, 1), std::next(sub, 1), sub_len - 1))
+				return candidate;
+
+			i = std::distance(p, candidate) + 1;
 		}
 
 		return nullptr;
 	}
 
 public:
-	virtual void reset() {cur_msg_len = -1; remain_len = 0;}
+#ifdef ASCS_POOLED_RECV_BUFFER
+	virtual void reset() {cur_msg_len = -1; remain_len = 0; scan_pos = 0; raw_buff.detach();}
+#else
+	virtual void reset() {cur_msg_len = -1; remain_len = 0; scan_pos = 0;}
+#endif
 	virtual bool parse_msg(size_t bytes_transferred, container_type& msg_can)
 	{
 		//length + msg
 		remain_len += bytes_transferred;
 		assert(remain_len <= ASCS_MSG_BUFFER_SIZE);
+#ifdef ASCS_POOLED_RECV_BUFFER
+		auto full = remain_len == raw_buff.size();
+#endif
 
 		auto pnext = &*std::begin(raw_buff);
 		auto min_len = _prefix.size() + _suffix.size();
@@ -416,13 +1087,30 @@ public:
 			remain_len -= cur_msg_len;
 			std::advance(pnext, cur_msg_len);
 			cur_msg_len = -1;
+			scan_pos = 0;
 		}
 
 		if (pnext == &*std::begin(raw_buff)) //we should have at least got one msg.
+		{
+			//unless the msg is still valid and, in read-some mode (see i_unpacker::read_some) or the stub buffer is full (see macro ASCS_POOLED_RECV_BUFFER)
+#ifdef ASCS_POOLED_RECV_BUFFER
+			if ((read_some() || (full && !raw_buff.attached())) && 0 != peek_msg(remain_len, pnext))
+			{
+				raw_buff.adjust(remain_len, full);
+				return true;
+			}
+#else
+			if (read_some() && 0 != peek_msg(remain_len, pnext))
+				return true;
+#endif
 			return false;
+		}
 		else if (remain_len > 0)
 			memmove(&*std::begin(raw_buff), pnext, remain_len); //left behind unparsed msg
 
+#ifdef ASCS_POOLED_RECV_BUFFER
+		raw_buff.adjust(remain_len, full);
+#endif
 		return true;
 	}
 
@@ -443,16 +1131,40 @@ public:
 	//this is just to satisfy the compiler, it's not a real scatter-gather buffer,
 	//if you introduce a ring buffer, then you will have the chance to provide a real scatter-gather buffer.
 #ifdef ASCS_SCATTERED_RECV_BUFFER
-	virtual buffer_type prepare_next_recv() {assert(remain_len < ASCS_MSG_BUFFER_SIZE); return buffer_type(1, asio::buffer(raw_buff) + remain_len);}
+	virtual buffer_type prepare_next_recv() {assert(remain_len < raw_buff.size()); return buffer_type(1, asio::buffer(raw_buff.data(), raw_buff.size()) + remain_len);}
 #else
-	virtual buffer_type prepare_next_recv() {assert(remain_len < ASCS_MSG_BUFFER_SIZE); return asio::buffer(asio::buffer(raw_buff) + remain_len);}
+	virtual buffer_type prepare_next_recv() {assert(remain_len < raw_buff.size()); return asio::buffer(asio::buffer(raw_buff.data(), raw_buff.size()) + remain_len);}
 #endif
 
 private:
-	std::array<char, ASCS_MSG_BUFFER_SIZE> raw_buff;
+#ifdef ASCS_SIMD_WIDTH
+	//a bit mask of positions (in [p, p + ASCS_SIMD_WIDTH)) where both the first and the last byte of sub matched.
+	static unsigned candidates(const char* p, const char* sub, size_t sub_len)
+	{
+#if 32 == ASCS_SIMD_WIDTH
+		auto first = _mm256_cmpeq_epi8(_mm256_set1_epi8(*sub), _mm256_loadu_si256((const __m256i*) p));
+		auto last = _mm256_cmpeq_epi8(_mm256_set1_epi8(sub[sub_len - 1]), _mm256_loadu_si256((const __m256i*) std::next(p, sub_len - 1)));
+		return (unsigned) _mm256_movemask_epi8(_mm256_and_si256(first, last));
+#else
+		auto first = _mm_cmpeq_epi8(_mm_set1_epi8(*sub), _mm_loadu_si128((const __m128i*) p));
+		auto last = _mm_cmpeq_epi8(_mm_set1_epi8(sub[sub_len - 1]), _mm_loadu_si128((const __m128i*) std::next(p, sub_len - 1)));
+		return (unsigned) _mm_movemask_epi8(_mm_and_si128(first, last));
+#endif
+	}
+
+#ifdef _MSC_VER
+	static unsigned lowest_bit(unsigned mask) {unsigned long index; _BitScanForward(&index, mask); return (unsigned) index;}
+#else
+	static unsigned lowest_bit(unsigned mask) {return (unsigned) __builtin_ctz(mask);}
+#endif
+#endif
+
+private:
+	raw_buffer_type raw_buff;
 	std::string _prefix, _suffix;
 	size_t cur_msg_len; //-1 means prefix not received, 0 means prefix received but suffix not received, otherwise message length (include prefix and suffix)
 	size_t remain_len; //half-baked msg
+	size_t scan_pos; //where to resume the scanning of the suffix, see peek_msg
 };
 
 //protocol: stream (non-protocol)
@@ -460,7 +1172,11 @@ private:
 class stream_unpacker : public i_unpacker<std::string>
 {
 public:
+#ifdef ASCS_POOLED_RECV_BUFFER
+	virtual void reset() {raw_buff.detach();}
+#else
 	virtual void reset() {}
+#endif
 	virtual bool parse_msg(size_t bytes_transferred, container_type& msg_can)
 	{
 		if (0 == bytes_transferred)
@@ -469,6 +1185,9 @@ public:
 		assert(bytes_transferred <= ASCS_MSG_BUFFER_SIZE);
 
 		msg_can.emplace_back(raw_buff.data(), bytes_transferred);
+#ifdef ASCS_POOLED_RECV_BUFFER
+		raw_buff.adjust(0, bytes_transferred == raw_buff.size());
+#endif
 		return true;
 	}
 
@@ -477,13 +1196,13 @@ public:
 	//this is just to satisfy the compiler, it's not a real scatter-gather buffer,
 	//if you introduce a ring buffer, then you will have the chance to provide a real scatter-gather buffer.
 #ifdef ASCS_SCATTERED_RECV_BUFFER
-	virtual buffer_type prepare_next_recv() {return buffer_type(1, asio::buffer(raw_buff));}
+	virtual buffer_type prepare_next_recv() {return buffer_type(1, asio::buffer(raw_buff.data(), raw_buff.size()));}
 #else
-	virtual buffer_type prepare_next_recv() {return asio::buffer(raw_buff);}
+	virtual buffer_type prepare_next_recv() {return asio::buffer(raw_buff.data(), raw_buff.size());}
 #endif
 
 protected:
-	std::array<char, ASCS_MSG_BUFFER_SIZE> raw_buff;
+	raw_buffer_type raw_buff;
 };
 
 }} //namespace
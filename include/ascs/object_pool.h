@@ -312,6 +312,39 @@ public:
 				break;
 	}
 
+	//take a snapshot of all objects (object_can_mutex will only be held during copying the smart pointers), split it into chunks (4 chunks per
+	//cpu core), then invoke __pred on every object in service threads in parallel, so __pred must be thread safe and be invoked asynchronously.
+	//on_complete (if any) will be invoked in one of the service threads after all objects been handled, or be invoked directly if there's no object.
+	template<typename _Predicate> void parallel_do_something_to_all(const _Predicate& __pred, const std::function<void()>& on_complete = std::function<void()>())
+	{
+		auto objects = std::make_shared<std::vector<object_type>>();
+		{
+			ASCS_SHARED_LOCK_TYPE<ASCS_SHARED_MUTEX_TYPE> lock(object_can_mutex);
+			objects->reserve(object_can.size());
+			for (auto& item : object_can)
+				objects->emplace_back(item.second);
+		}
+
+		if (objects->empty())
+		{
+			if (on_complete)
+				on_complete();
+			return;
+		}
+
+		auto chunk_size = (objects->size() - 1) / (4 * (size_t) std::max(std::thread::hardware_concurrency(), 1u)) + 1;
+		auto left_num = std::make_shared<std::atomic_size_t>((objects->size() - 1) / chunk_size + 1);
+		auto pred = std::make_shared<_Predicate>(__pred);
+		for (size_t i = 0; i < objects->size(); i += chunk_size)
+			post([=]() {
+				for (auto j = i; j < i + chunk_size && j < objects->size(); ++j)
+					(*pred)((*objects)[j]);
+
+				if (0 == --*left_num && on_complete)
+					on_complete();
+			});
+	}
+
 private:
 	std::atomic_uint_fast64_t cur_id;
 
@@ -29,16 +29,18 @@ private:
 
 public:
 	static const tid TIMER_BEGIN = super::TIMER_END;
-	static const tid TIMER_CHECK_RECV = TIMER_BEGIN;
-	static const tid TIMER_DISPATCH_MSG = TIMER_BEGIN + 1;
-	static const tid TIMER_DELAY_CLOSE = TIMER_BEGIN + 2;
-	static const tid TIMER_HEARTBEAT_CHECK = TIMER_BEGIN + 3;
+	static const tid TIMER_DISPATCH_MSG = TIMER_BEGIN;
+	static const tid TIMER_DELAY_CLOSE = TIMER_BEGIN + 1;
+	static const tid TIMER_HEARTBEAT_CHECK = TIMER_BEGIN + 2;
 	static const tid TIMER_END = TIMER_BEGIN + 10;
 
 protected:
 	socket(asio::io_context& io_context_) : super(io_context_), rw_strand(io_context_), next_layer_(io_context_), dis_strand(io_context_) {first_init();}
 	template<typename Arg> socket(asio::io_context& io_context_, Arg&& arg) :
 		super(io_context_), rw_strand(io_context_), next_layer_(io_context_, std::forward<Arg>(arg)), dis_strand(io_context_) {first_init();}
+#if defined(ASCS_SEND_BUF_BUDGET) || defined(ASCS_RECV_BUF_BUDGET)
+	~socket() {clear_buffer();} //give back the budget
+#endif
 
 	//helper function, just call it in constructor
 	void first_init()
@@ -55,9 +57,18 @@ protected:
 #endif
 		started_ = false;
 		dispatching = false;
+		dispatch_deferred = false;
 		recv_idle_began = false;
-		msg_resuming_interval_ = ASCS_MSG_RESUMING_INTERVAL;
+		send_buffer_congested = false;
+		send_buffer_low_watermark_ = ASCS_SEND_BUF_LOW_WATERMARK;
+		recv_buffer_low_watermark_ = ASCS_RECV_BUF_LOW_WATERMARK;
+#if defined(ASCS_RECV_BUF_BUDGET) && defined(ASCS_DISPATCH_BATCH_MSG)
+		recv_budget_changes = 0;
+#endif
 		msg_handling_interval_ = ASCS_MSG_HANDLING_INTERVAL;
+#ifdef ASCS_MSG_TTL
+		msg_ttl_ = ASCS_MSG_TTL;
+#endif
 		start_atomic.clear(std::memory_order_relaxed);
 	}
 
@@ -82,7 +93,9 @@ protected:
 		sr_status = sync_recv_status::NOT_REQUESTED;
 #endif
 		dispatching = false;
+		dispatch_deferred = false;
 		recv_idle_began = false;
+		send_buffer_congested = false;
 		clear_buffer();
 	}
 
@@ -91,8 +104,19 @@ protected:
 #ifndef ASCS_DISPATCH_BATCH_MSG
 		dispatching_msg.clear();
 #endif
+#ifdef ASCS_SEND_BUF_BUDGET
+		in_container_type can; //to know how many bytes have been cleared
+		send_buffer.swap(can);
+		shrink_send_budget(ascs::get_size_in_byte(can));
+#else
 		send_buffer.clear();
+#endif
+#ifdef ASCS_RECV_BUF_BUDGET
+		out_container_type temp_can;
+		swap_recv_buffer(temp_can);
+#else
 		recv_buffer.clear();
+#endif
 	}
 
 public:
@@ -104,7 +128,11 @@ public:
 	typedef obj_with_begin_time<OutMsgType> out_msg;
 	typedef InContainer<in_msg> in_container_type;
 	typedef OutContainer<out_msg> out_container_type;
+#if ASCS_SEND_LANE_NUM > 1
+	typedef lane_queue<InQueue, in_container_type, ASCS_SEND_LANE_NUM> in_queue_type;
+#else
 	typedef InQueue<in_container_type> in_queue_type;
+#endif
 	typedef OutQueue<out_container_type> out_queue_type;
 
 	uint_fast64_t id() const {return _id;}
@@ -177,14 +205,34 @@ public:
 
 	bool is_sending() const {return sending;}
 	bool is_dispatching() const {return dispatching;}
+	bool is_dispatch_deferred() const {return dispatch_deferred;}
 	bool is_recv_idle() const {return recv_idle_began;}
 
-	void msg_resuming_interval(unsigned interval) {msg_resuming_interval_ = interval;}
-	unsigned msg_resuming_interval() const {return msg_resuming_interval_;}
-
 	void msg_handling_interval(size_t interval) {msg_handling_interval_ = interval;}
 	size_t msg_handling_interval() const {return msg_handling_interval_;}
 
+	//call defer_dispatch in on_msg_handle before it returns false (or 0 if ASCS_DISPATCH_BATCH_MSG been defined), then message dispatching will not
+	//be retried after msg_handling_interval milliseconds, but be paused until resume_dispatch been called (from any thread, at any time),
+	//this is useful if on_msg_handle waits for some resources (for example, handing messages over to other asynchronous backends).
+	//if on_msg_handle returns true (or non-zero) at last, defer_dispatch will be ignored.
+	void defer_dispatch() {dispatch_deferred = true;}
+	void resume_dispatch() {post_strand(dis_strand, [this]() {if (this->dispatch_deferred) {this->dispatch_deferred = false; this->do_dispatch_msg();}});}
+
+	void send_buffer_low_watermark(size_t size) {assert(size > 0); send_buffer_low_watermark_ = size;}
+	size_t send_buffer_low_watermark() const {return send_buffer_low_watermark_;}
+
+	//if message receiving has been suspended because of the receive buffer overflow, it will be resumed as soon as
+	//the receive buffer drained below this low watermark (by message dispatching or pop_first/all_pending_recv_msg).
+	void recv_buffer_low_watermark(size_t size) {assert(size > 0); recv_buffer_low_watermark_ = size;}
+	size_t recv_buffer_low_watermark() const {return recv_buffer_low_watermark_;}
+
+#ifdef ASCS_MSG_TTL
+	//messages which stayed in the send buffer for msg_ttl milliseconds or longer will be dropped instead of being sent (see on_msg_expired),
+	//0 means never expire. it's per-socket, the default value is ASCS_MSG_TTL.
+	void msg_ttl(unsigned ttl) {msg_ttl_ = ttl;}
+	unsigned msg_ttl() const {return msg_ttl_;}
+#endif
+
 	//in ascs, it's thread safe to access stat without mutex, because for a specific member of stat, ascs will never access it concurrently.
 	//but user can access stat out of ascs via get_statistic function, although user can only read it, there's still a potential risk,
 	//so whether it's thread safe or not depends on std::chrono::system_clock::duration.
@@ -210,17 +258,43 @@ public:
 
 	//if you use can_overflow = true to invoke send_msg or send_native_msg, it will always succeed no matter the sending buffer is overflow or not,
 	//this can exhaust all virtual memory, please pay special attentions.
-	bool is_send_buffer_available() const {return send_buffer.size_in_byte() < ASCS_MAX_SEND_BUF;}
+	//once this function returned false, on_send_buffer_writable will be invoked and wait_send_buffer_writable will return after the send buffer
+	//drained below the low watermark (see send_buffer_low_watermark function).
+	//if ASCS_SEND_BUF_BUDGET been defined and exhausted, this function also returns false unless the send buffer is empty.
+	bool is_send_buffer_available() const
+	{
+		auto size = send_buffer.size_in_byte();
+		if (size < ASCS_MAX_SEND_BUF && is_send_budget_available(size))
+			return true;
+
+		send_buffer_congested = true;
+		return false;
+	}
+
+	//wait until the send buffer drained below the low watermark or this socket becomes not ready, at most duration milliseconds,
+	//return true if the send buffer is available now.
+	bool wait_send_buffer_writable(unsigned duration)
+	{
+		std::unique_lock<std::mutex> lock(send_buffer_mutex);
+		send_buffer_cv.wait_for(lock, std::chrono::milliseconds(duration),
+			[this]() {auto size = this->send_buffer.size_in_byte(); return !this->is_ready() || (size < this->send_buffer_low_watermark_ && is_send_budget_available(size));});
+
+		return is_send_buffer_available();
+	}
 
 	//if you define macro ASCS_PASSIVE_RECV and call recv_msg greedily, the receiving buffer may overflow, this can exhaust all virtual memory,
 	//to avoid this problem, call recv_msg only if is_recv_buffer_available() returns true.
-	bool is_recv_buffer_available() const {return recv_buffer.size_in_byte() < ASCS_MAX_RECV_BUF;}
+	//if ASCS_RECV_BUF_BUDGET been defined and exhausted, this function also returns false unless the recv buffer is empty.
+	bool is_recv_buffer_available() const {auto size = recv_buffer.size_in_byte(); return size < ASCS_MAX_RECV_BUF && is_recv_budget_available(size);}
 
 	//don't use the packer but insert into send buffer directly
 	template<typename T> bool direct_send_msg(T&& msg, bool can_overflow = false)
 		{return can_overflow || is_send_buffer_available() ? do_direct_send_msg(std::forward<T>(msg)) : false;}
 	bool direct_send_msg(list<InMsgType>& msg_can, bool can_overflow = false)
 		{return can_overflow || is_send_buffer_available() ? do_direct_send_msg(msg_can) : false;}
+	//put msg into the given lane of the send buffer, lane ASCS_SEND_LANE_NUM - 1 has the highest priority, see macro ASCS_SEND_LANE_NUM for more details.
+	template<typename T> bool direct_send_priority_msg(size_t priority, T&& msg, bool can_overflow = false)
+		{return can_overflow || is_send_buffer_available() ? do_direct_send_msg(std::forward<T>(msg), priority) : false;}
 
 #ifdef ASCS_SYNC_SEND
 	//don't use the packer but insert into send buffer directly, then wait for the sending to finish, unit of the duration is millisecond, 0 means wait infinitely
@@ -259,16 +333,33 @@ public:
 	GET_PENDING_MSG_SIZE(get_pending_send_msg_size, send_buffer)
 	GET_PENDING_MSG_SIZE(get_pending_recv_msg_size, recv_buffer)
 
+	void pop_first_pending_send_msg(in_msg& msg)
+	{
+		msg.clear();
+		if (send_buffer.try_dequeue(msg))
+		{
+			shrink_send_budget(msg.size());
 #ifdef ASCS_SYNC_SEND
-	POP_FIRST_PENDING_MSG_NOTIFY(pop_first_pending_send_msg, send_buffer, in_msg)
-	POP_ALL_PENDING_MSG_NOTIFY(pop_all_pending_send_msg, send_buffer, in_container_type)
-#else
-	POP_FIRST_PENDING_MSG(pop_first_pending_send_msg, send_buffer, in_msg)
-	POP_ALL_PENDING_MSG(pop_all_pending_send_msg, send_buffer, in_container_type)
+			if (msg.p)
+				msg.p->set_value(sync_call_result::NOT_APPLICABLE);
+#endif
+		}
+	}
+
+	void pop_all_pending_send_msg(in_container_type& can)
+	{
+		can.clear();
+		send_buffer.swap(can);
+#ifdef ASCS_SEND_BUF_BUDGET
+		shrink_send_budget(ascs::get_size_in_byte(can));
+#endif
+#ifdef ASCS_SYNC_SEND
+		ascs::do_something_to_all(can, [](in_msg& msg) {if (msg.p) msg.p->set_value(sync_call_result::NOT_APPLICABLE);});
 #endif
+	}
 
-	POP_FIRST_PENDING_MSG(pop_first_pending_recv_msg, recv_buffer, out_msg)
-	POP_ALL_PENDING_MSG(pop_all_pending_recv_msg, recv_buffer, out_container_type)
+	void pop_first_pending_recv_msg(out_msg& msg) {msg.clear(); dequeue_recv_msg(msg); check_recv_resuming();}
+	void pop_all_pending_recv_msg(out_container_type& can) {can.clear(); swap_recv_buffer(can); check_recv_resuming();}
 
 protected:
 	virtual bool do_start()
@@ -278,7 +369,8 @@ protected:
 		start_heartbeat(ASCS_HEARTBEAT_INTERVAL);
 #endif
 		send_msg(); //send buffer may have msgs, send them
-		recv_msg();
+		if (!recv_idle_began || end_recv_idle()) //message receiving may have been suspended on the last link, then resume it only once
+			recv_msg();
 
 		return true;
 	}
@@ -329,6 +421,14 @@ protected:
 	//notice: the msg is packed, using inconstant is for the convenience of swapping
 	virtual void on_all_msg_send(InMsgType& msg) {}
 #endif
+#ifdef ASCS_MSG_TTL
+	//one msg has been dropped because it stayed in the send buffer too long (see msg_ttl function), it will be invoked in rw_strand
+	//notice: the msg is packed, using inconstant is for the convenience of swapping
+	virtual void on_msg_expired(InMsgType& msg) {}
+#endif
+	//the send buffer has been found unavailable, and now it drained below the low watermark, you can send messages again,
+	//this is the non-blocking alternative of safe_send_(native_)msg, it will be invoked in rw_strand, so do not block it.
+	virtual void on_send_buffer_writable() {}
 
 	//subclass notify shutdown event
 	bool close()
@@ -431,19 +531,30 @@ protected:
 				temp_buffer.emplace_back(std::move(*iter));
 			temp_msg_can.clear();
 
-			recv_buffer.move_items_in(temp_buffer, size_in_byte);
+			move_items_in_recv_buffer(temp_buffer, size_in_byte);
 			dispatch_msg();
 		}
 
 		return handled_msg();
 	}
 
-	template<typename T> bool do_direct_send_msg(T&& msg)
+	template<typename T> bool do_direct_send_msg(T&& msg, size_t priority = 0)
 	{
+		auto size = msg.size();
 		if (msg.empty())
 			unified_out::error_out("found an empty message, please check your packer.");
-		else if (send_buffer.enqueue(std::forward<T>(msg)))
-			send_msg();
+		else
+		{
+			grow_send_budget(size); //before the msg can be sent
+#if ASCS_SEND_LANE_NUM > 1
+			if (send_buffer.enqueue(std::forward<T>(msg), priority))
+#else
+			if (send_buffer.enqueue(std::forward<T>(msg)))
+#endif
+				send_msg();
+			else
+				shrink_send_budget(size);
+		}
 
 		//even if we meet an empty message (because of too big message or insufficient memory, most likely), we still return true, why?
 		//please think about the function safe_send_(native_)msg, if we keep returning false, it will enter a dead loop.
@@ -455,13 +566,38 @@ protected:
 	{
 		size_t size_in_byte = 0;
 		in_container_type temp_buffer;
-		ascs::do_something_to_all(msg_can, [&size_in_byte, &temp_buffer](InMsgType& msg) {size_in_byte += msg.size(); temp_buffer.emplace_back(std::move(msg));});
+		ascs::do_something_to_all(msg_can, [&size_in_byte, &temp_buffer](InMsgType& msg) {
+			size_in_byte += msg.size(); temp_buffer.emplace_back(std::move(msg)); temp_buffer.back().more_pieces = true;});
+		if (!temp_buffer.empty()) //pieces of one message will be sent without any other messages between them (see lane_queue)
+		{
+			temp_buffer.back().more_pieces = false;
+#ifdef ASCS_MSG_TTL
+			//all pieces of one message share the same enqueue time, then they will expire together
+			ascs::do_something_to_all(temp_buffer, [&temp_buffer](in_msg& msg) {msg.stamp(temp_buffer.front().enqueue_time);});
+#endif
+		}
+		grow_send_budget(size_in_byte); //before the msgs can be sent
 		send_buffer.move_items_in(temp_buffer, size_in_byte);
 		send_msg();
 
 		return true;
 	}
 
+	//call this after messages been moved out of the send buffer (in rw_strand)
+	void check_send_buffer_writable()
+	{
+		auto size = send_buffer.size_in_byte();
+		if (send_buffer_congested && size < send_buffer_low_watermark_ && is_send_budget_available(size))
+		{
+			{
+				std::lock_guard<std::mutex> lock(send_buffer_mutex);
+				send_buffer_congested = false;
+			}
+			send_buffer_cv.notify_all();
+			on_send_buffer_writable();
+		}
+	}
+
 #ifdef ASCS_SYNC_SEND
 	template<typename T> sync_call_result do_direct_sync_send_msg(T&& msg, unsigned duration = 0)
 	{
@@ -476,8 +612,13 @@ protected:
 		auto unused = in_msg(std::forward<T>(msg), true);
 		auto p = unused.p;
 		auto f = p->get_future();
+		auto size = unused.size();
+		grow_send_budget(size); //before the msg can be sent
 		if (!send_buffer.enqueue(std::move(unused)))
+		{
+			shrink_send_budget(size);
 			return sync_call_result::NOT_APPLICABLE;
+		}
 
 		send_msg();
 		return 0 == duration || std::future_status::ready == f.wait_for(std::chrono::milliseconds(duration)) ? f.get() : sync_call_result::TIMEOUT;
@@ -492,11 +633,21 @@ protected:
 
 		size_t size_in_byte = 0;
 		in_container_type temp_buffer;
-		ascs::do_something_to_all(msg_can, [&size_in_byte, &temp_buffer](InMsgType& msg) {size_in_byte += msg.size(); temp_buffer.emplace_back(std::move(msg));});
+		ascs::do_something_to_all(msg_can, [&size_in_byte, &temp_buffer](InMsgType& msg) {
+			size_in_byte += msg.size(); temp_buffer.emplace_back(std::move(msg)); temp_buffer.back().more_pieces = true;});
+		if (!temp_buffer.empty()) //pieces of one message will be sent without any other messages between them (see lane_queue)
+		{
+			temp_buffer.back().more_pieces = false;
+#ifdef ASCS_MSG_TTL
+			//all pieces of one message share the same enqueue time, then they will expire together
+			ascs::do_something_to_all(temp_buffer, [&temp_buffer](in_msg& msg) {msg.stamp(temp_buffer.front().enqueue_time);});
+#endif
+		}
 
 		temp_buffer.back().check_and_create_promise(true);
 		auto p = temp_buffer.back().p;
 		auto f = p->get_future();
+		grow_send_budget(size_in_byte); //before the msgs can be sent
 		send_buffer.move_items_in(temp_buffer, size_in_byte);
 
 		send_msg();
@@ -504,6 +655,40 @@ protected:
 	}
 #endif
 
+	//a socket with an empty buffer can always buffer messages regardless of the budget, otherwise it may never be woken up or resumed.
+	static bool is_send_budget_available(size_t size)
+	{
+#ifdef ASCS_SEND_BUF_BUDGET
+		return 0 == size || send_buffer_budget().is_available();
+#else
+		return true;
+#endif
+	}
+
+	static bool is_recv_budget_available(size_t size)
+	{
+#ifdef ASCS_RECV_BUF_BUDGET
+		return 0 == size || recv_buffer_budget().is_available();
+#else
+		return true;
+#endif
+	}
+
+	//report how many bytes the send buffer gained (before they can be sent) or lost (after they have been moved out), see buffer_budget.
+	void grow_send_budget(size_t size)
+	{
+#ifdef ASCS_SEND_BUF_BUDGET
+		send_buffer_budget().grow(size);
+#endif
+	}
+
+	void shrink_send_budget(size_t size)
+	{
+#ifdef ASCS_SEND_BUF_BUDGET
+		send_buffer_budget().shrink(size);
+#endif
+	}
+
 private:
 	virtual void do_recv_msg() = 0;
 	virtual bool do_send_msg(bool in_strand = false) = 0;
@@ -526,39 +711,108 @@ private:
 	}
 #endif
 
-	bool check_receiving(bool raise_recv)
+	//all changes of the recv buffer go through the following functions, to report them to the budget (see buffer_budget).
+	//with ASCS_DISPATCH_BATCH_MSG, on_msg_handle takes msgs out of the recv buffer by itself, how many bytes it took can only be known by
+	//comparing the sizes of the recv buffer before and after it, so other changes during it are recorded in recv_budget_changes, and they
+	//are serialized with the comparison by recv_budget_mutex (once per receiving, not per msg, and never held during on_msg_handle).
+	void move_items_in_recv_buffer(out_container_type& can, size_t size_in_byte)
 	{
-		if (is_recv_buffer_available())
-		{
-			if (recv_idle_began)
-			{
-				recv_idle_began = false;
-				stat.recv_idle_sum += statistic::now() - recv_idle_begin_time;
-			}
+#ifdef ASCS_RECV_BUF_BUDGET
+		if (0 == size_in_byte)
+			size_in_byte = ascs::get_size_in_byte(can);
+		recv_buffer_budget().grow(size_in_byte); //before the msgs can be dispatched
+#ifdef ASCS_DISPATCH_BATCH_MSG
+		std::lock_guard<std::mutex> lock(recv_budget_mutex);
+		recv_budget_changes += size_in_byte;
+#endif
+#endif
+		recv_buffer.move_items_in(can, size_in_byte);
+	}
 
-			if (raise_recv)
-				recv_msg(); //receive msg in sequence
+	bool dequeue_recv_msg(out_msg& msg)
+	{
+#if defined(ASCS_RECV_BUF_BUDGET) && defined(ASCS_DISPATCH_BATCH_MSG)
+		std::lock_guard<std::mutex> lock(recv_budget_mutex);
+#endif
+		if (!recv_buffer.try_dequeue(msg))
+			return false;
 
-			return true;
-		}
-		else if (!recv_idle_began)
-		{
-			recv_idle_began = true;
-			recv_idle_begin_time = statistic::now();
-		}
+#ifdef ASCS_RECV_BUF_BUDGET
+		recv_buffer_budget().shrink(msg.size());
+#ifdef ASCS_DISPATCH_BATCH_MSG
+		recv_budget_changes -= msg.size();
+#endif
+#endif
+		return true;
+	}
 
-		return false;
+	void swap_recv_buffer(out_container_type& can) //can must be empty
+	{
+#if defined(ASCS_RECV_BUF_BUDGET) && defined(ASCS_DISPATCH_BATCH_MSG)
+		std::lock_guard<std::mutex> lock(recv_budget_mutex);
+#endif
+		recv_buffer.swap(can);
+#ifdef ASCS_RECV_BUF_BUDGET
+		auto size_in_byte = ascs::get_size_in_byte(can);
+		recv_buffer_budget().shrink(size_in_byte);
+#ifdef ASCS_DISPATCH_BATCH_MSG
+		recv_budget_changes -= size_in_byte;
+#endif
+#endif
+	}
+
+#if defined(ASCS_RECV_BUF_BUDGET) && defined(ASCS_DISPATCH_BATCH_MSG)
+	size_t begin_batch_dispatching()
+	{
+		std::lock_guard<std::mutex> lock(recv_budget_mutex);
+		recv_budget_changes = 0;
+		return recv_buffer.size_in_byte();
+	}
+
+	void end_batch_dispatching(size_t size_in_byte) //size_in_byte: the size of the recv buffer before on_msg_handle
+	{
+		std::lock_guard<std::mutex> lock(recv_budget_mutex);
+		recv_buffer_budget().shrink(size_in_byte + recv_budget_changes - recv_buffer.size_in_byte()); //unsigned arithmetic
+	}
+#endif
+
+	//only one of rw_strand (via handled_msg) and dis_strand (via check_recv_resuming) can end the suspension of message receiving
+	bool end_recv_idle()
+	{
+		auto idle = true;
+		if (!recv_idle_began.compare_exchange_strong(idle, false))
+			return false;
+
+		stat.recv_idle_sum += statistic::now() - recv_idle_begin_time;
+		return true;
 	}
 
 	bool handled_msg()
 	{
 #ifndef ASCS_PASSIVE_RECV
-		if (check_receiving(false))
+		if (is_recv_buffer_available())
 			return true;
 
-		set_timer(TIMER_CHECK_RECV, msg_resuming_interval_, [this](tid id)->bool {return !this->check_receiving(true);});
-#endif
+		recv_idle_begin_time = statistic::now();
+		recv_idle_began = true;
+		//dispatching may have drained the receive buffer before recv_idle_began been set, if so, nobody will resume message receiving.
+		return is_recv_buffer_available() && end_recv_idle();
+#else
 		return false;
+#endif
+	}
+
+	//resume message receiving immediately if it has been suspended and the receive buffer drained below the low watermark
+	void check_recv_resuming()
+	{
+#ifndef ASCS_PASSIVE_RECV
+		if (recv_idle_began && is_ready()) //after closing, do_start will resume message receiving
+		{
+			auto size = recv_buffer.size_in_byte();
+			if (size < recv_buffer_low_watermark_ && is_recv_budget_available(size) && end_recv_idle())
+				recv_msg();
+		}
+#endif
 	}
 
 	//do not use dispatch_strand at here, because the handler (do_dispatch_msg) may call this function, which can lead stack overflow.
@@ -571,8 +825,14 @@ private:
 			auto begin_time = statistic::now();
 #ifdef ASCS_FULL_STATISTIC
 			recv_buffer.do_something_to_all([&, this](out_msg& msg) {this->stat.dispatch_delay_sum += begin_time - msg.begin_time;});
+#endif
+#ifdef ASCS_RECV_BUF_BUDGET
+			auto size_in_byte = begin_batch_dispatching();
 #endif
 			auto re = on_msg_handle(recv_buffer);
+#ifdef ASCS_RECV_BUF_BUDGET
+			end_batch_dispatching(size_in_byte);
+#endif
 			auto end_time = statistic::now();
 			stat.handle_time_sum += end_time - begin_time;
 
@@ -581,12 +841,13 @@ private:
 #ifdef ASCS_FULL_STATISTIC
 				recv_buffer.do_something_to_all([&end_time](out_msg& msg) {msg.restart(end_time);});
 #endif
-				set_timer(TIMER_DISPATCH_MSG, msg_handling_interval_, [this](tid id)->bool {return this->timer_handler(TIMER_DISPATCH_MSG);}); //hold dispatching
+				if (!dispatch_deferred) //otherwise, hold dispatching until resume_dispatch been called
+					set_timer(TIMER_DISPATCH_MSG, msg_handling_interval_, [this](tid id)->bool {return this->timer_handler(TIMER_DISPATCH_MSG);});
 			}
 			else
 			{
 #else
-		if (dispatching || (dispatching = recv_buffer.try_dequeue(dispatching_msg)))
+		if (dispatching || (dispatching = dequeue_recv_msg(dispatching_msg)))
 		{
 			auto begin_time = statistic::now();
 			stat.dispatch_delay_sum += begin_time - dispatching_msg.begin_time;
@@ -597,12 +858,15 @@ private:
 			if (!re) //dispatch failed, re-dispatch
 			{
 				dispatching_msg.restart(end_time);
-				set_timer(TIMER_DISPATCH_MSG, msg_handling_interval_, [this](tid id)->bool {return this->timer_handler(TIMER_DISPATCH_MSG);}); //hold dispatching
+				if (!dispatch_deferred) //otherwise, hold dispatching until resume_dispatch been called
+					set_timer(TIMER_DISPATCH_MSG, msg_handling_interval_, [this](tid id)->bool {return this->timer_handler(TIMER_DISPATCH_MSG);});
 			}
 			else
 			{
 				dispatching_msg.clear();
 #endif
+				check_recv_resuming();
+				dispatch_deferred = false;
 				dispatching = false;
 				dispatch_msg(); //dispatch msg in sequence
 			}
@@ -615,9 +879,8 @@ private:
 	{
 		switch (id)
 		{
-		case TIMER_DISPATCH_MSG:
-			dispatching = false;
-			dispatch_msg();
+		case TIMER_DISPATCH_MSG: //hold dispatching (the failed message must be re-dispatched first), so don't call dispatch_msg
+			post_strand(dis_strand, [this]() {this->do_dispatch_msg();});
 			break;
 		case TIMER_DELAY_CLOSE:
 			if (!is_last_async_call())
@@ -653,21 +916,34 @@ protected:
 	in_queue_type send_buffer;
 	volatile bool sending;
 
+	mutable std::atomic_bool send_buffer_congested;
+	size_t send_buffer_low_watermark_;
+#ifdef ASCS_MSG_TTL
+	unsigned msg_ttl_;
+#endif
+	std::mutex send_buffer_mutex;
+	std::condition_variable send_buffer_cv;
+
 #ifdef ASCS_PASSIVE_RECV
 	volatile bool reading;
 #endif
 	asio::io_context::strand rw_strand;
 
 private:
-	bool recv_idle_began;
+	std::atomic_bool recv_idle_began;
 	volatile bool started_; //has started or not
 	volatile bool dispatching;
+	volatile bool dispatch_deferred;
 #ifndef ASCS_DISPATCH_BATCH_MSG
 	out_msg dispatching_msg;
 #endif
 
 	typename statistic::stat_time recv_idle_begin_time;
 	out_queue_type recv_buffer;
+#if defined(ASCS_RECV_BUF_BUDGET) && defined(ASCS_DISPATCH_BATCH_MSG)
+	std::mutex recv_budget_mutex;
+	size_t recv_budget_changes; //growth minus shrinkage of the recv buffer during on_msg_handle (unsigned arithmetic), except on_msg_handle itself
+#endif
 
 	uint_fast64_t _id;
 	Socket next_layer_;
@@ -683,7 +959,8 @@ private:
 	std::condition_variable sync_recv_cv;
 #endif
 
-	unsigned msg_resuming_interval_, msg_handling_interval_;
+	size_t recv_buffer_low_watermark_;
+	unsigned msg_handling_interval_;
 };
 
 template<typename Socket, typename Packer, typename Unpacker,
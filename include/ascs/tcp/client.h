@@ -67,6 +67,11 @@ public:
 	//msg sending interface
 	TCP_BROADCAST_MSG(broadcast_msg, send_msg)
 	TCP_BROADCAST_MSG(broadcast_native_msg, send_native_msg)
+	//pack only once, see macro TCP_BROADCAST_SHARED_MSG for more details
+	TCP_BROADCAST_SHARED_MSG(broadcast_shared_msg, false)
+	TCP_BROADCAST_SHARED_MSG(broadcast_shared_native_msg, true)
+	TCP_PARALLEL_BROADCAST_MSG(parallel_broadcast_msg, false)
+	TCP_PARALLEL_BROADCAST_MSG(parallel_broadcast_native_msg, true)
 	//guarantee send msg successfully even if can_overflow equal to false
 	//success at here just means put the msg into tcp::socket_base's send buffer
 	TCP_BROADCAST_MSG(safe_broadcast_msg, safe_send_msg)
@@ -15,6 +15,20 @@
 
 #include "../socket.h"
 
+#if defined(ASCS_FILE_REGION) && defined(__linux__)
+#include <sys/sendfile.h>
+#endif
+#ifdef ASCS_ZEROCOPY_THRESHOLD
+#include <sys/socket.h>
+#include <linux/errqueue.h>
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY		60
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY	0x4000000
+#endif
+#endif
+
 namespace ascs { namespace tcp {
 
 template <typename Socket, typename Packer, typename Unpacker,
@@ -33,8 +47,26 @@ private:
 protected:
 	enum link_status {CONNECTED, FORCE_SHUTTING_DOWN, GRACEFUL_SHUTTING_DOWN, BROKEN};
 
-	socket_base(asio::io_context& io_context_) : super(io_context_), status(link_status::BROKEN) {}
-	template<typename Arg> socket_base(asio::io_context& io_context_, Arg&& arg) : super(io_context_, std::forward<Arg>(arg)), status(link_status::BROKEN) {}
+	socket_base(asio::io_context& io_context_) : super(io_context_), status(link_status::BROKEN), cork_timer(io_context_) {first_init();}
+	template<typename Arg> socket_base(asio::io_context& io_context_, Arg&& arg) : super(io_context_, std::forward<Arg>(arg)), status(link_status::BROKEN), cork_timer(io_context_) {first_init();}
+
+	//helper function, just call it in constructor
+	void first_init()
+	{
+		sending_msg_num = 0;
+		coalescing_threshold_ = ASCS_SEND_COALESCING_THRESHOLD;
+		cork_delay_ = ASCS_CORK_DELAY;
+		cork_threshold_ = ASCS_CORK_THRESHOLD;
+		corked = false;
+#ifdef ASCS_MSG_TTL
+		last_msg_expired = false;
+#endif
+#ifdef ASCS_ZEROCOPY_THRESHOLD
+		zerocopy_threshold_ = std::is_same<Socket, asio::ip::tcp::socket>::value ? ASCS_ZEROCOPY_THRESHOLD : 0; //plain tcp only
+		zerocopy_enabled = zerocopy_waiting = false;
+		zerocopy_seq = 0;
+#endif
+	}
 
 public:
 	static const typename super::tid TIMER_BEGIN = super::TIMER_END;
@@ -48,7 +80,7 @@ public:
 		auto_duration dur(stat.pack_time_sum);
 		auto msg = packer_->pack_heartbeat();
 		dur.end();
-		do_direct_send_msg(std::move(msg));
+		do_direct_send_msg(std::move(msg), ASCS_SEND_LANE_NUM - 1); //the highest priority
 	}
 
 	//reset all, be ensure that there's no any operations performed on this socket when invoke it
@@ -56,7 +88,28 @@ public:
 	//notice, when reusing this socket, object_pool will invoke this function, so if you want to do some additional initialization
 	// for this socket, do it at here and in the constructor.
 	//for tcp::single_client_base and ssl::single_client_base, this virtual function will never be called, please note.
-	virtual void reset() {status = link_status::BROKEN; sending_msgs.clear(); super::reset();}
+	virtual void reset() {status = link_status::BROKEN; sending_msgs.clear(); stop_cork(); super::reset();}
+
+	//messages smaller than this threshold will be copied into a contiguous buffer before sending, 0 means disable coalescing,
+	//see macro ASCS_SEND_COALESCING_THRESHOLD for more details.
+	void coalescing_threshold(size_t threshold) {coalescing_threshold_ = threshold;}
+	size_t coalescing_threshold() const {return coalescing_threshold_;}
+
+	//when this socket is idle (not sending), the first message will not be sent immediately, but after at most cork_delay microseconds,
+	//or the send buffer reached cork_threshold bytes, so bursts of messages can be sent in fewer batches. 0 delay means disable corking,
+	//latency-sensitive sockets should keep it. see macro ASCS_CORK_DELAY and ASCS_CORK_THRESHOLD for more details.
+	void cork_delay(unsigned delay) {cork_delay_ = delay;}
+	unsigned cork_delay() const {return cork_delay_;}
+	void cork_threshold(size_t threshold) {cork_threshold_ = threshold;}
+	size_t cork_threshold() const {return cork_threshold_;}
+
+#ifdef ASCS_ZEROCOPY_THRESHOLD
+	//messages not smaller than this threshold will be sent with MSG_ZEROCOPY (plain tcp only), 0 means disable zero copy,
+	//see macro ASCS_ZEROCOPY_THRESHOLD for more details.
+	void zerocopy_threshold(size_t threshold) {if (std::is_same<Socket, asio::ip::tcp::socket>::value) zerocopy_threshold_ = threshold;}
+	size_t zerocopy_threshold() const {return zerocopy_threshold_;}
+	size_t pinned_msg_num() const {return zerocopy_msgs.size();} //msgs which have been sent with MSG_ZEROCOPY but not yet been released by the kernel
+#endif
 
 	//SOCKET status
 	bool is_broken() const {return link_status::BROKEN == status;}
@@ -120,6 +173,9 @@ public:
 	//success at here just means put the msg into tcp::socket_base's send buffer
 	TCP_SAFE_SEND_MSG(safe_send_msg, send_msg)
 	TCP_SAFE_SEND_MSG(safe_send_native_msg, send_native_msg)
+	//higher priority msgs will be sent first, see macro ASCS_SEND_LANE_NUM for more details.
+	TCP_SEND_PRIORITY_MSG(send_priority_msg, false)
+	TCP_SEND_PRIORITY_MSG(send_priority_native_msg, true)
 
 #ifdef ASCS_SYNC_SEND
 	TCP_SYNC_SEND_MSG(sync_send_msg, false) //use the packer with native = false to pack the msgs
@@ -165,6 +221,11 @@ protected:
 	virtual bool do_start()
 	{
 		status = link_status::CONNECTED;
+#ifdef ASCS_ZEROCOPY_THRESHOLD
+		release_zerocopy_msgs(); //completions of the previous connection will never arrive
+		zerocopy_enabled = false; //SO_ZEROCOPY belongs to the socket (not this object)
+		zerocopy_seq = 0;
+#endif
 		stat.establish_time = time(nullptr);
 
 		on_connect(); //in this virtual function, stat.last_recv_time has not been updated (super::do_start will update it), please note
@@ -178,6 +239,18 @@ protected:
 	virtual void on_send_error(const asio::error_code& ec, typename super::in_container_type& msg_can)
 		{unified_out::error_out("send msg error (%d %s)", ec.value(), ec.message().data());}
 
+#ifdef ASCS_WANT_BATCH_MSG_SEND_NOTIFY
+	//all msgs in msg_can have been sent to the kernel buffer by one async_write, invoked in rw_strand,
+	//by default, on_msg_send will be invoked for each of them (if macro ASCS_WANT_MSG_SEND_NOTIFY also been defined).
+	//notice: msgs are packed, you can swap their content, but do not remove them from msg_can.
+	virtual void on_msgs_send(typename super::in_container_type& msg_can)
+	{
+#ifdef ASCS_WANT_MSG_SEND_NOTIFY
+		ascs::do_something_to_all(msg_can, [this](typename super::in_msg& msg) {this->on_msg_send(msg);});
+#endif
+	}
+#endif
+
 	virtual void on_recv_error(const asio::error_code& ec) = 0;
 
 	virtual void on_close()
@@ -208,6 +281,7 @@ private:
 	{
 		if (!is_broken())
 			status = link_status::FORCE_SHUTTING_DOWN; //not thread safe because of this assignment
+		this->dispatch_strand(rw_strand, [this]() {this->stop_cork();}); //a pending uncork must not run against a closing socket
 		close();
 	}
 
@@ -232,9 +306,13 @@ private:
 #ifdef ASCS_PASSIVE_RECV
 			reading = true;
 #endif
-			asio::async_read(this->next_layer(), recv_buff,
-				[this](const asio::error_code& ec, size_t bytes_transferred)->size_t {return this->completion_checker(ec, bytes_transferred);}, make_strand_handler(rw_strand,
+			if (unpacker_->read_some()) //parse_msg will be called after every read, see i_unpacker::read_some for more details
+				this->next_layer().async_read_some(recv_buff, make_strand_handler(rw_strand,
 					this->make_handler_error_size([this](const asio::error_code& ec, size_t bytes_transferred) {this->recv_handler(ec, bytes_transferred);})));
+			else
+				asio::async_read(this->next_layer(), recv_buff,
+					[this](const asio::error_code& ec, size_t bytes_transferred)->size_t {return this->completion_checker(ec, bytes_transferred);}, make_strand_handler(rw_strand,
+						this->make_handler_error_size([this](const asio::error_code& ec, size_t bytes_transferred) {this->recv_handler(ec, bytes_transferred);})));
 		}
 	}
 
@@ -279,48 +357,474 @@ private:
 	{
 		if (!in_strand && sending)
 			return true;
+		else if (!in_strand && cork_delay_ > 0 && send_buffer.size_in_byte() < cork_threshold_)
+		{
+			if (!corked) //wait for more messages
+			{
+				corked = true;
+#if ASIO_VERSION >= 101100
+				cork_timer.expires_after(std::chrono::microseconds(cork_delay_));
+#else
+				cork_timer.expires_from_now(std::chrono::microseconds(cork_delay_));
+#endif
+				cork_timer.async_wait(make_strand_handler(rw_strand, this->make_handler_error([this](const asio::error_code& ec) {if (!ec) this->uncork();})));
+			}
+
+			return true;
+		}
+		else if (corked) //cork_threshold reached
+			stop_cork();
 
 		auto end_time = statistic::now();
-#ifdef ASCS_WANT_MSG_SEND_NOTIFY
-		send_buffer.move_items_out(0, sending_msgs);
+#ifdef ASCS_MSG_TTL
+		do
+		{
+			fetch_msgs();
+			drop_expired_msgs();
+		} while (sending_msgs.empty() && !send_buffer.empty()); //all msgs in this batch have expired, try the next batch
 #else
-		send_buffer.move_items_out(asio::detail::default_max_transfer_size, sending_msgs);
+		fetch_msgs();
 #endif
-		sending_buffer.clear(); //this buffer will not be refreshed according to sending_msgs timely
-		ascs::do_something_to_all(sending_msgs, [this, &end_time](typename super::in_msg& item) {
-			this->stat.send_delay_sum += end_time - item.begin_time;
-			this->sending_buffer.emplace_back(item.data(), item.size());
-		});
+		ascs::do_something_to_all(sending_msgs, [this, &end_time](typename super::in_msg& item) {this->stat.send_delay_sum += end_time - item.begin_time;});
 
-		if ((sending = !sending_buffer.empty()))
+		if ((sending = !sending_msgs.empty()))
 		{
 			sending_msgs.front().restart();
-			asio::async_write(this->next_layer(), sending_buffer, make_strand_handler(rw_strand,
-				this->make_handler_error_size([this](const asio::error_code& ec, size_t bytes_transferred) {this->send_handler(ec, bytes_transferred);})));
+			sending_msg_num = 0;
+			send_segment(std::begin(sending_msgs));
+			this->check_send_buffer_writable(); //after sending been set, because on_send_buffer_writable may send messages
 			return true;
 		}
 
 		return false;
 	}
 
+	void fetch_msgs()
+	{
+#if defined(ASCS_WANT_MSG_SEND_NOTIFY) && !defined(ASCS_WANT_BATCH_MSG_SEND_NOTIFY)
+		send_buffer.move_items_out(0, sending_msgs); //one msg per async_write, then on_msg_send can be invoked for each of them
+#else
+		send_buffer.move_items_out(asio::detail::default_max_transfer_size, sending_msgs);
+#endif
+#ifdef ASCS_SEND_BUF_BUDGET
+		this->shrink_send_budget(ascs::get_size_in_byte(sending_msgs)); //sending_msgs was empty
+#endif
+	}
+
+	//send msgs from first to the end of sending_msgs, if file regions exist, they will be sent separately, msgs between them will be
+	//sent via one async_write as usual, send_handler will be invoked after all of them been sent (or an error occurred).
+	void send_segment(typename super::in_container_type::iterator first)
+	{
+		auto last = std::end(sending_msgs);
+#ifdef ASCS_FILE_REGION
+		auto region = ascs::to_file_region(static_cast<in_msg_type&>(*first));
+		if (nullptr != region)
+		{
+			++sending_msg_num;
+			next_segment = std::next(first);
+			send_file_region(*region, 0, std::is_same<Socket, asio::ip::tcp::socket>());
+			return;
+		}
+#endif
+#ifdef ASCS_ZEROCOPY_THRESHOLD
+		if (is_zerocopy_msg(*first))
+		{
+			++sending_msg_num;
+			next_segment = std::next(first);
+			zerocopy_send(first, 0);
+			return;
+		}
+#endif
+#if defined(ASCS_FILE_REGION) || defined(ASCS_ZEROCOPY_THRESHOLD)
+		for (last = std::next(first); last != std::end(sending_msgs) && !is_separate_msg(*last); ++last);
+		next_segment = last;
+#endif
+
+		sending_buffer.clear(); //this buffer will not be refreshed according to sending_msgs timely
+		if (0 == coalescing_threshold_)
+			for (auto iter = first; iter != last; ++iter, ++sending_msg_num)
+				append_buffers(sending_buffer, static_cast<in_msg_type&>(*iter));
+		else
+		{
+			//a msg may consist of several buffers (ext::inline_header_msg for example) which are not covered by its size, so coalescing_buffer
+			//cannot be reserved exactly, then pointers into it will be filled after all small msgs have been copied (it may be reallocated).
+			coalescing_buffer.clear();
+			coalescing_items.clear();
+			auto coalescing = false; //the last item in sending_buffer is in coalescing_buffer
+			for (auto iter = first; iter != last; ++iter, ++sending_msg_num)
+			{
+				auto num = sending_buffer.size();
+				append_buffers(sending_buffer, static_cast<in_msg_type&>(*iter));
+				if (iter->size() >= coalescing_threshold_)
+					coalescing = false;
+				else if (num < sending_buffer.size())
+				{
+					if (!coalescing)
+						coalescing_items.emplace_back(num, coalescing_buffer.size());
+					for (auto i = num; i < sending_buffer.size(); ++i) //copy all buffers of the msg
+						coalescing_buffer.append((const char*) sending_buffer[i].data(), sending_buffer[i].size());
+					sending_buffer.resize(coalescing ? num : num + 1);
+					coalescing = true;
+				}
+			}
+
+			for (auto iter = std::begin(coalescing_items); iter != std::end(coalescing_items); ++iter)
+			{
+				auto next = std::next(iter);
+				auto end = next == std::end(coalescing_items) ? coalescing_buffer.size() : next->second;
+				sending_buffer[iter->first] = asio::const_buffer(std::next(coalescing_buffer.data(), iter->second), end - iter->second);
+			}
+		}
+
+		asio::async_write(this->next_layer(), sending_buffer, make_strand_handler(rw_strand,
+			this->make_handler_error_size([this](const asio::error_code& ec, size_t bytes_transferred) {this->send_handler(ec, bytes_transferred);})));
+	}
+
+#if defined(ASCS_FILE_REGION) || defined(ASCS_ZEROCOPY_THRESHOLD)
+	bool is_separate_msg(typename super::in_msg& msg) const
+	{
+#ifdef ASCS_FILE_REGION
+		if (nullptr != ascs::to_file_region(static_cast<in_msg_type&>(msg)))
+			return true;
+#endif
+#ifdef ASCS_ZEROCOPY_THRESHOLD
+		if (is_zerocopy_msg(msg))
+			return true;
+#endif
+		return false;
+	}
+#endif
+
+#ifdef ASCS_ZEROCOPY_THRESHOLD
+	bool is_zerocopy_msg(typename super::in_msg& msg) const
+	{
+#ifdef ASCS_FILE_REGION
+		if (nullptr != ascs::to_file_region(static_cast<in_msg_type&>(msg)))
+			return false;
+#endif
+		return zerocopy_threshold_ > 0 && msg.size() >= zerocopy_threshold_;
+	}
+
+	//hand the msg over to the kernel with MSG_ZEROCOPY, it must stay untouched until the kernel releases it (see handle_zerocopy_completion),
+	//so after been sent, it will be moved from sending_msgs to zerocopy_msgs (see pin_zerocopy_msgs) instead of being freed.
+	void zerocopy_send(typename super::in_container_type::iterator iter, size_t bytes_transferred, uint32_t sent_num = 0) //sent_num: successful zero copy sends
+	{
+		asio::error_code ec;
+		auto& s = this->lowest_layer();
+		sending_buffer.clear(); //a msg may consist of several buffers
+		append_buffers(sending_buffer, static_cast<in_msg_type&>(*iter));
+		if (!zerocopy_enabled)
+		{
+			int on = 1;
+			if (0 != setsockopt(s.native_handle(), SOL_SOCKET, SO_ZEROCOPY, &on, sizeof(on))) //bytes_transferred must be zero here
+			{
+				unified_out::warning_out("cannot enable SO_ZEROCOPY (%d), zero copy disabled.", errno);
+				zerocopy_threshold_ = 0;
+				asio::async_write(this->next_layer(), sending_buffer, make_strand_handler(rw_strand,
+					this->make_handler_error_size([this](const asio::error_code& ec, size_t bytes_transferred) {this->send_handler(ec, bytes_transferred);})));
+				return;
+			}
+			zerocopy_enabled = true;
+		}
+
+		auto total_len = asio::buffer_size(sending_buffer); //not iter->size(), a msg may consist of several buffers
+		while (!ec && bytes_transferred < total_len)
+		{
+			struct iovec iov[8]; //skip what have been sent
+			struct msghdr msg = {};
+			msg.msg_iov = iov;
+			auto skip = bytes_transferred;
+			for (auto& item : sending_buffer)
+				if (skip >= item.size())
+					skip -= item.size();
+				else if (msg.msg_iovlen < sizeof(iov) / sizeof(iov[0]))
+				{
+					iov[msg.msg_iovlen].iov_base = const_cast<char*>(std::next((const char*) item.data(), skip));
+					iov[msg.msg_iovlen++].iov_len = item.size() - skip;
+					skip = 0;
+				}
+
+			auto re = ::sendmsg(s.native_handle(), &msg, MSG_ZEROCOPY | MSG_DONTWAIT | MSG_NOSIGNAL);
+			if (re >= 0)
+			{
+				bytes_transferred += (size_t) re;
+				++zerocopy_seq; //each successful zero copy send consumes one notification id
+				++sent_num;
+			}
+			else if (EAGAIN == errno || EWOULDBLOCK == errno) //wait for the socket to become writable
+			{
+				s.async_wait(asio::socket_base::wait_write, make_strand_handler(rw_strand, this->make_handler_error([=](const asio::error_code& ec) {
+					if (ec) this->send_handler(ec, bytes_transferred); else this->zerocopy_send(iter, bytes_transferred, sent_num);})));
+				return;
+			}
+			else if (ENOBUFS == errno) //too many outstanding zero copy sends (see optmem_max), copy this time
+			{
+				re = ::sendmsg(s.native_handle(), &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+				if (re > 0)
+					bytes_transferred += (size_t) re;
+				else if (re < 0 && EAGAIN != errno && EWOULDBLOCK != errno && EINTR != errno)
+					ec = asio::error_code(errno, asio::error::get_system_category());
+			}
+			else if (EINTR != errno)
+				ec = asio::error_code(errno, asio::error::get_system_category());
+		}
+
+		if (sent_num > 0) //this msg occupies notification ids [zerocopy_seq - sent_num, zerocopy_seq - 1]
+		{
+			zerocopy_pending.emplace_back(iter, std::make_pair(zerocopy_seq - sent_num, zerocopy_seq - 1));
+			++stat.zerocopy_msg_sum;
+		}
+		//do not invoke send_handler directly, because we may be in do_send_msg
+		this->post_strand(rw_strand, [=]() {this->send_handler(ec, bytes_transferred);});
+	}
+
+	//move msgs which have been sent with MSG_ZEROCOPY from sending_msgs to zerocopy_msgs, invoked after the whole batch been sent.
+	void pin_zerocopy_msgs()
+	{
+		if (zerocopy_pending.empty())
+			return;
+
+		for (auto& item : zerocopy_pending)
+			zerocopy_msgs.pin(sending_msgs, item.first, item.second.first, item.second.second);
+		zerocopy_pending.clear();
+		//the kernel may have released some of them before they been pinned
+		zerocopy_msgs.release([this](typename super::in_container_type& msg_can) {this->on_zerocopy_msgs_released(msg_can);});
+		wait_zerocopy_completion();
+	}
+
+	void wait_zerocopy_completion()
+	{
+		if (zerocopy_waiting || zerocopy_msgs.empty())
+			return;
+
+		//the kernel reports completions via the error queue, which makes the socket readable with an error (EPOLLERR)
+		zerocopy_waiting = true;
+		this->lowest_layer().async_wait(asio::socket_base::wait_error, make_strand_handler(rw_strand,
+			this->make_handler_error([this](const asio::error_code& ec) {this->zerocopy_waiting = false; if (!ec) this->handle_zerocopy_completion();})));
+		handle_zerocopy_completion(); //completions may arrived before we started waiting
+	}
+
+	void handle_zerocopy_completion()
+	{
+		char control[128];
+		for (;;)
+		{
+			struct msghdr msg = {};
+			msg.msg_control = control;
+			msg.msg_controllen = sizeof(control);
+			if (recvmsg(this->lowest_layer().native_handle(), &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+				break;
+
+			for (auto cmsg = CMSG_FIRSTHDR(&msg); nullptr != cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+			{
+				if (!(SOL_IP == cmsg->cmsg_level && IP_RECVERR == cmsg->cmsg_type) && !(SOL_IPV6 == cmsg->cmsg_level && IPV6_RECVERR == cmsg->cmsg_type))
+					continue;
+
+				auto serr = (struct sock_extended_err*) CMSG_DATA(cmsg);
+				if (SO_EE_ORIGIN_ZEROCOPY != serr->ee_origin || 0 != serr->ee_errno)
+					continue;
+
+				if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) //the kernel fell back to copying (for example, loopback or no scatter-gather support)
+					stat.zerocopy_copied_sum += serr->ee_data - serr->ee_info + 1;
+				zerocopy_msgs.complete(serr->ee_info, serr->ee_data, //[ee_info, ee_data] have completed
+					[this](typename super::in_container_type& msg_can) {this->on_zerocopy_msgs_released(msg_can);});
+			}
+		}
+
+		wait_zerocopy_completion();
+	}
+
+	void on_zerocopy_msgs_released(typename super::in_container_type& msg_can)
+	{
+#ifdef ASCS_SYNC_SEND
+		ascs::do_something_to_all(msg_can, [](typename super::in_msg& msg) {if (msg.p) msg.p->set_value(sync_call_result::SUCCESS);});
+#endif
+#ifdef ASCS_WANT_BATCH_MSG_SEND_NOTIFY
+		this->on_msgs_send(msg_can);
+#elif defined(ASCS_WANT_MSG_SEND_NOTIFY)
+		ascs::do_something_to_all(msg_can, [this](typename super::in_msg& msg) {this->on_msg_send(msg);});
+#endif
+	}
+
+	void release_zerocopy_msgs()
+	{
+#ifdef ASCS_SYNC_SEND
+		zerocopy_msgs.do_something_to_all([](typename super::in_msg& msg) {if (msg.p) msg.p->set_value(sync_call_result::NOT_APPLICABLE);});
+#endif
+		zerocopy_msgs.clear();
+		zerocopy_pending.clear();
+	}
+#endif
+
+#ifdef ASCS_FILE_REGION
+	//transmit the file region via sendfile(2) directly, no data will be copied into the user space.
+	void send_file_region(file_region& region, size_t bytes_transferred, const std::true_type&)
+	{
+#ifdef __linux__
+		asio::error_code ec;
+		auto& s = this->lowest_layer();
+		if (!s.native_non_blocking())
+			s.native_non_blocking(true, ec);
+
+		while (!ec && region.remain() > 0)
+		{
+			auto offset = region.offset();
+			auto re = ::sendfile(s.native_handle(), region.fd(), &offset, region.remain() > 0x7ffff000 ? 0x7ffff000 : region.remain());
+			if (re > 0)
+			{
+				region.consume((size_t) re);
+				bytes_transferred += (size_t) re;
+			}
+			else if (0 == re) //the file has been truncated
+				ec = asio::error::eof;
+			else if (EAGAIN == errno || EWOULDBLOCK == errno) //wait for the socket to become writable
+			{
+				auto r = &region;
+#if ASIO_VERSION >= 101100
+				s.async_wait(asio::socket_base::wait_write, make_strand_handler(rw_strand, this->make_handler_error([=](const asio::error_code& ec) {
+					if (ec) this->send_handler(ec, bytes_transferred); else this->send_file_region(*r, bytes_transferred, std::true_type());})));
+#else
+				s.async_write_some(asio::null_buffers(), make_strand_handler(rw_strand, this->make_handler_error_size([=](const asio::error_code& ec, size_t) {
+					if (ec) this->send_handler(ec, bytes_transferred); else this->send_file_region(*r, bytes_transferred, std::true_type());})));
+#endif
+				return;
+			}
+			else if (EINTR != errno)
+				ec = asio::error_code(errno, asio::error::get_system_category());
+		}
+
+		//do not invoke send_handler directly, because we may be in do_send_msg
+		this->post_strand(rw_strand, [=]() {this->send_handler(ec, bytes_transferred);});
+#else
+		send_file_region(region, bytes_transferred, std::false_type());
+#endif
+	}
+
+	//read the file region chunk by chunk and then send it, for ssl or platforms that sendfile(2) is not available.
+	void send_file_region(file_region& region, size_t bytes_transferred, const std::false_type&)
+	{
+		auto len = region.read_chunk();
+		if (0 == len)
+		{
+			asio::error_code ec;
+			if (region.remain() > 0) //errno can be zero if the file has been truncated (short read)
+				ec = 0 != errno ? asio::error_code(errno, asio::error::get_system_category()) : asio::error::eof;
+			this->post_strand(rw_strand, [=]() {this->send_handler(ec, bytes_transferred);});
+			return;
+		}
+
+		auto r = &region;
+		asio::async_write(this->next_layer(), asio::buffer(region.data(), len),
+			make_strand_handler(rw_strand, this->make_handler_error_size([=](const asio::error_code& ec, size_t bytes) {
+				r->consume(bytes);
+				if (ec || 0 == r->remain())
+					this->send_handler(ec, bytes_transferred + bytes);
+				else
+					this->send_file_region(*r, bytes_transferred + bytes, std::false_type());
+			})));
+	}
+#endif
+
+#ifdef ASCS_MSG_TTL
+	void drop_expired_msgs()
+	{
+		if (0 == this->msg_ttl_ || sending_msgs.empty())
+			return;
+
+		auto now = std::chrono::steady_clock::now();
+		auto ttl = this->msg_ttl_;
+		auto expired = false;
+		ascs::do_something_to_one(sending_msgs, [&](typename super::in_msg& item) {return expired = item.expired(now, ttl);});
+		if (!expired)
+		{
+			last_enqueue_time = sending_msgs.back().enqueue_time;
+			last_msg_expired = false;
+			return;
+		}
+
+		typename super::in_container_type temp_buffer;
+		ascs::do_something_to_all(sending_msgs, [&](typename super::in_msg& item) {
+			//pieces of one message share the same enqueue time, they must be sent or dropped together (even across batches).
+			if (item.enqueue_time != this->last_enqueue_time)
+			{
+				this->last_enqueue_time = item.enqueue_time;
+				if ((this->last_msg_expired = item.expired(now, ttl)))
+				{
+					++this->stat.expired_msg_sum;
+					this->on_msg_expired(item);
+				}
+			}
+
+			if (!this->last_msg_expired)
+				temp_buffer.emplace_back(std::move(item));
+#ifdef ASCS_SYNC_SEND
+			else if (item.p)
+				item.p->set_value(sync_call_result::NOT_APPLICABLE);
+#endif
+		});
+		sending_msgs.swap(temp_buffer);
+		if (sending_msgs.empty())
+			this->check_send_buffer_writable(); //expired messages have been removed from the send buffer
+	}
+#endif
+
+	//cork_timer can only be accessed in rw_strand, except in reset().
+	void uncork() //invoked by cork_timer
+	{
+		if (corked)
+		{
+			corked = false;
+			if (!sending && is_ready())
+				do_send_msg(true);
+		}
+	}
+
+	void stop_cork()
+	{
+		if (corked)
+		{
+			corked = false;
+			try {cork_timer.cancel();}
+			catch (const asio::system_error& e) {unified_out::error_out("cannot stop cork timer (%d %s)", e.code().value(), e.what());}
+		}
+	}
+
 	void send_handler(const asio::error_code& ec, size_t bytes_transferred)
 	{
 		if (!ec)
 		{
+#if defined(ASCS_FILE_REGION) || defined(ASCS_ZEROCOPY_THRESHOLD)
+			if (next_segment != std::end(sending_msgs)) //not all msgs have been sent, see send_segment
+			{
+				stat.send_byte_sum += bytes_transferred;
+				send_segment(next_segment);
+				return;
+			}
+#endif
 			stat.last_send_time = time(nullptr);
 
 			stat.send_byte_sum += bytes_transferred;
 			stat.send_time_sum += statistic::now() - sending_msgs.front().begin_time;
-			stat.send_msg_sum += sending_buffer.size();
+			stat.send_msg_sum += sending_msg_num;
+#ifdef ASCS_ZEROCOPY_THRESHOLD
+			pin_zerocopy_msgs(); //they will be notified after been released by the kernel
+			if (!sending_msgs.empty())
+			{
+#endif
 #ifdef ASCS_SYNC_SEND
 			ascs::do_something_to_all(sending_msgs, [](typename super::in_msg& item) {if (item.p) {item.p->set_value(sync_call_result::SUCCESS);}});
 #endif
-#ifdef ASCS_WANT_MSG_SEND_NOTIFY
+#ifdef ASCS_WANT_BATCH_MSG_SEND_NOTIFY
+			this->on_msgs_send(sending_msgs);
+#elif defined(ASCS_WANT_MSG_SEND_NOTIFY)
 			this->on_msg_send(sending_msgs.front());
 #endif
 #ifdef ASCS_WANT_ALL_MSG_SEND_NOTIFY
 			if (send_buffer.empty())
 				this->on_all_msg_send(sending_msgs.back());
+#endif
+#ifdef ASCS_ZEROCOPY_THRESHOLD
+			}
 #endif
 			sending_msgs.clear();
 			if (!do_send_msg(true) && !send_buffer.empty()) //send msg in sequence
@@ -328,6 +832,9 @@ private:
 		}
 		else
 		{
+#ifdef ASCS_ZEROCOPY_THRESHOLD
+			zerocopy_pending.clear(); //the connection is broken, no completions will arrive
+#endif
 #ifdef ASCS_SYNC_SEND
 			ascs::do_something_to_all(sending_msgs, [](typename super::in_msg& item) {if (item.p) {item.p->set_value(sync_call_result::NOT_APPLICABLE);}});
 #endif
@@ -377,6 +884,30 @@ private:
 
 	typename super::in_container_type sending_msgs;
 	std::vector<asio::const_buffer> sending_buffer; //just to reduce memory allocation and keep the size of sending items (linear complexity, it's very important).
+	size_t sending_msg_num; //how many msgs in sending_msgs, counted by send_segment, because Container's size() may have linear complexity
+	size_t coalescing_threshold_;
+#if defined(ASCS_FILE_REGION) || defined(ASCS_ZEROCOPY_THRESHOLD)
+	typename super::in_container_type::iterator next_segment; //where send_segment will start from when the current segment has been sent
+#endif
+#ifdef ASCS_ZEROCOPY_THRESHOLD
+	size_t zerocopy_threshold_;
+	bool zerocopy_enabled, zerocopy_waiting;
+	uint32_t zerocopy_seq; //notification id of the next zero copy send
+	//sent but not yet pinned (in sending_msgs), with the first and the last notification id of each msg
+	std::vector<std::pair<typename super::in_container_type::iterator, std::pair<uint32_t, uint32_t>>> zerocopy_pending;
+	zerocopy_list<typename super::in_container_type> zerocopy_msgs; //pinned msgs, waiting for the kernel to release them
+#endif
+	std::string coalescing_buffer; //small messages will be copied into it, to reduce the number of buffers passed to async_write.
+	std::vector<std::pair<size_t, size_t>> coalescing_items; //index in sending_buffer and offset in coalescing_buffer of each coalesced run of msgs
+
+	unsigned cork_delay_; //microseconds
+	size_t cork_threshold_;
+	bool corked;
+#ifdef ASCS_MSG_TTL
+	typename super::in_msg::ttl_time last_enqueue_time; //enqueue time of the last message which has been sent or dropped
+	bool last_msg_expired;
+#endif
+	asio::steady_timer cork_timer;
 };
 
 }} //namespace
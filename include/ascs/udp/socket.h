@@ -39,7 +39,7 @@ public:
 	virtual void send_heartbeat()
 	{
 		in_msg_type msg(peer_addr, packer_->pack_heartbeat());
-		do_direct_send_msg(std::move(msg));
+		do_direct_send_msg(std::move(msg), ASCS_SEND_LANE_NUM - 1); //the highest priority
 	}
 	virtual const char* type_name() const {return "UDP";}
 	virtual int type_id() const {return 0;}
@@ -238,12 +238,34 @@ private:
 			return true;
 
 		if ((sending = send_buffer.try_dequeue(sending_msg)))
+			this->shrink_send_budget(sending_msg.size());
+#ifdef ASCS_MSG_TTL
+		if (sending && this->msg_ttl_ > 0)
+		{
+			auto now = std::chrono::steady_clock::now();
+			while (sending && sending_msg.expired(now, this->msg_ttl_))
+			{
+				++stat.expired_msg_sum;
+#ifdef ASCS_SYNC_SEND
+				if (sending_msg.p)
+					sending_msg.p->set_value(sync_call_result::NOT_APPLICABLE);
+#endif
+				this->on_msg_expired(sending_msg);
+				if ((sending = send_buffer.try_dequeue(sending_msg)))
+					this->shrink_send_budget(sending_msg.size());
+				else
+					this->check_send_buffer_writable(); //expired messages have been removed from the send buffer
+			}
+		}
+#endif
+		if (sending)
 		{
 			stat.send_delay_sum += statistic::now() - sending_msg.begin_time;
 
 			sending_msg.restart();
 			this->next_layer().async_send_to(asio::buffer(sending_msg.data(), sending_msg.size()), sending_msg.peer_addr, make_strand_handler(rw_strand,
 				this->make_handler_error_size([this](const asio::error_code& ec, size_t bytes_transferred) {this->send_handler(ec, bytes_transferred);})));
+			this->check_send_buffer_writable(); //after sending been set, because on_send_buffer_writable may send messages
 			return true;
 		}
 